@@ -0,0 +1,78 @@
+#ifndef CODINGAME_ARENA_HPP
+#define CODINGAME_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+// Bump allocator for the temporaries of a turn.
+// Memory is taken from one buffer allocated up front and is only given back
+// all at once by reset(), at the start of the next turn: nothing allocated
+// from the arena may outlive the turn. Freeing the last block rolls the top
+// back, so a growing vector reuses its space. Requests that do not fit fall
+// back to the heap and are counted, the capacity should be raised then.
+class Arena {
+public:
+    explicit Arena(std::size_t capacity)
+        : m_buffer(new unsigned char[capacity]), m_capacity(capacity), m_top(0), m_peak(0), m_nbOverflows(0) {}
+
+    void* allocate(std::size_t size, std::size_t alignment) {
+        const std::size_t base = reinterpret_cast<std::uintptr_t>(m_buffer.get());
+        const std::size_t start = ((base + m_top + alignment - 1) & ~(alignment - 1)) - base;
+        if (start + size > m_capacity) {
+            ++m_nbOverflows;
+            return ::operator new(size);
+        }
+        m_top = start + size;
+        if (m_top > m_peak)
+            m_peak = m_top;
+        return m_buffer.get() + start;
+    }
+    void deallocate(void* p, std::size_t size) {
+        unsigned char* block = static_cast<unsigned char*>(p);
+        if (block < m_buffer.get() || block >= m_buffer.get() + m_capacity)
+            ::operator delete(p);
+        else if (block + size == m_buffer.get() + m_top)
+            m_top = block - m_buffer.get();
+    }
+    void reset() { m_top = 0; }
+
+    std::size_t getCapacity() const { return m_capacity; }
+    // Highest use since construction, in bytes.
+    std::size_t getPeak() const { return m_peak; }
+    std::size_t getNbOverflows() const { return m_nbOverflows; }
+
+private:
+    std::unique_ptr<unsigned char[]> m_buffer;
+    std::size_t m_capacity;
+    std::size_t m_top;
+    std::size_t m_peak;
+    std::size_t m_nbOverflows;
+};
+
+// Standard allocator over an Arena, for the containers of a turn.
+template<typename T>
+struct ArenaAllocator {
+    typedef T value_type;
+
+    explicit ArenaAllocator(Arena& arena) : m_arena(&arena) {}
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : m_arena(other.m_arena) {}
+
+    T* allocate(std::size_t n) { return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T* p, std::size_t n) { m_arena->deallocate(p, n * sizeof(T)); }
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return m_arena == other.m_arena; }
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return m_arena != other.m_arena; }
+
+    Arena* m_arena;
+};
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T> >;
+
+#endif
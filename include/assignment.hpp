@@ -0,0 +1,87 @@
+#ifndef CODINGAME_ASSIGNMENT_HPP
+#define CODINGAME_ASSIGNMENT_HPP
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+// Minimum cost assignment of every row to a distinct column (Hungarian
+// method with potentials, O(rows^2 * cols)). Costs are a row major
+// nbRows x nbCols matrix with nbRows <= nbCols; an unwanted pairing is
+// just a very large cost. Buffers are kept between calls so that solving
+// the same size again does not allocate.
+class Assignment {
+public:
+    // Fills rowToCol[nbRows] and returns the total cost.
+    long long solve(const int* costs, int nbRows, int nbCols, int* rowToCol) {
+        if (nbRows == 0)
+            return 0;
+        const long long INF = std::numeric_limits<long long>::max() / 4;
+        // 1-indexed as in the textbook version, column 0 is the virtual start
+        m_u.assign(nbRows + 1, 0);
+        m_v.assign(nbCols + 1, 0);
+        m_colToRow.assign(nbCols + 1, 0);
+        m_way.assign(nbCols + 1, 0);
+        m_minV.resize(nbCols + 1);
+        m_used.resize(nbCols + 1);
+        for (int i = 1; i <= nbRows; ++i) {
+            m_colToRow[0] = i;
+            int j0 = 0;
+            std::fill(m_minV.begin(), m_minV.end(), INF);
+            std::fill(m_used.begin(), m_used.end(), 0);
+            do {
+                m_used[j0] = 1;
+                const int i0 = m_colToRow[j0];
+                const int* row = costs + (i0 - 1) * nbCols;
+                long long delta = INF;
+                int j1 = 0;
+                for (int j = 1; j <= nbCols; ++j) {
+                    if (m_used[j])
+                        continue;
+                    const long long cur = row[j - 1] - m_u[i0] - m_v[j];
+                    if (cur < m_minV[j]) {
+                        m_minV[j] = cur;
+                        m_way[j] = j0;
+                    }
+                    if (m_minV[j] < delta) {
+                        delta = m_minV[j];
+                        j1 = j;
+                    }
+                }
+                for (int j = 0; j <= nbCols; ++j) {
+                    if (m_used[j]) {
+                        m_u[m_colToRow[j]] += delta;
+                        m_v[j] -= delta;
+                    }
+                    else
+                        m_minV[j] -= delta;
+                }
+                j0 = j1;
+            } while (m_colToRow[j0] != 0);
+            // augmenting path back to the virtual column
+            do {
+                const int j1 = m_way[j0];
+                m_colToRow[j0] = m_colToRow[j1];
+                j0 = j1;
+            } while (j0 != 0);
+        }
+        long long total = 0;
+        for (int j = 1; j <= nbCols; ++j) {
+            if (m_colToRow[j] != 0) {
+                rowToCol[m_colToRow[j] - 1] = j - 1;
+                total += costs[(m_colToRow[j] - 1) * nbCols + j - 1];
+            }
+        }
+        return total;
+    }
+
+private:
+    std::vector<long long> m_u;
+    std::vector<long long> m_v;
+    std::vector<int> m_colToRow;
+    std::vector<int> m_way;
+    std::vector<long long> m_minV;
+    std::vector<char> m_used;
+};
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef CODINGAME_CAPTURE_HPP
+#define CODINGAME_CAPTURE_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fast_io.hpp"
+
+// Capture logs: the raw input of a real match (init block and every turn,
+// byte for byte as the referee sent it) behind a fixed header, so that a
+// replay can map the file and parse the input in place.
+// A bot captures when CG_CAPTURE names a file; the input is teed by the
+// io::Reader as it is read, so a match cut short still leaves its turns.
+namespace capture {
+
+static const char MAGIC[8] = { 'C', 'G', 'C', 'A', 'P', 'T', 'U', 'R' };
+static const std::uint32_t VERSION = 1;
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t size; // of the header, the input starts there
+    char bot[32]; // name of the bot that captured, null padded
+};
+static_assert(sizeof(Header) == 48, "the header is part of the file format");
+
+// Creates path with its header, returns the descriptor to tee the input to
+// (-1 on failure).
+inline int create(const char* path, const char* bot) {
+    const int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return -1;
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.size = sizeof(Header);
+    std::strncpy(header.bot, bot, sizeof(header.bot) - 1);
+    if (!io::writeAll(fd, reinterpret_cast<const char*>(&header), sizeof(header))) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Tees in to the file named by CG_CAPTURE, if set.
+inline void startFromEnv(io::Reader& in, const char* bot) {
+    if (const char* path = std::getenv("CG_CAPTURE"))
+        in.setTee(create(path, bot));
+}
+
+// Read-only mapping of a capture log.
+class Log {
+public:
+    explicit Log(const char* path) : m_data(nullptr), m_size(0), m_header(nullptr) {
+        const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return;
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size >= static_cast<off_t>(sizeof(Header))) {
+            void* p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                m_data = static_cast<const char*>(p);
+                m_size = st.st_size;
+            }
+        }
+        ::close(fd);
+        const Header* header = reinterpret_cast<const Header*>(m_data);
+        if (m_data != nullptr && std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 && header->version == VERSION
+            && header->size >= sizeof(Header) && header->size <= m_size)
+            m_header = header;
+    }
+    ~Log() {
+        if (m_data != nullptr)
+            ::munmap(const_cast<char*>(m_data), m_size);
+    }
+    Log(const Log&) = delete;
+    Log& operator=(const Log&) = delete;
+
+    // False if the file is missing or is not a capture log.
+    bool isValid() const { return m_header != nullptr; }
+    const char* getBot() const { return m_header->bot; }
+    // The captured input, to be parsed in place by an io::Reader.
+    const char* getInput() const { return m_data + m_header->size; }
+    std::size_t getInputSize() const { return m_size - m_header->size; }
+
+private:
+    const char* m_data;
+    std::size_t m_size;
+    const Header* m_header;
+};
+
+} // namespace capture
+
+#endif
@@ -0,0 +1,186 @@
+#ifndef CODINGAME_FAST_IO_HPP
+#define CODINGAME_FAST_IO_HPP
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#include <unistd.h>
+
+// Protocol I/O shared by the bots.
+// The reader pulls whatever the referee has sent in one read() and parses
+// integers and words straight from its buffer, without allocating.
+// The writer accumulates a whole turn and sends it with a single write().
+namespace io {
+
+// Writes the whole of data to fd, returns false if it could not.
+inline bool writeAll(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+class Reader {
+public:
+    static const std::size_t BUFFER_SIZE = 1 << 16;
+
+    // Reads from a file descriptor (stdin by default).
+    explicit Reader(int fd = 0)
+        : m_fd(fd), m_teeFd(-1), m_cur(m_buffer), m_end(m_buffer), m_eof(false) {}
+    // Reads from memory, the data must outlive the reader.
+    Reader(const char* data, std::size_t size)
+        : m_fd(-1), m_teeFd(-1), m_cur(data), m_end(data + size), m_eof(false) {}
+
+    // Copies everything then read from the descriptor to fd, as it arrives
+    // (capture logs); -1 stops.
+    void setTee(int fd) { m_teeFd = fd; }
+
+    void reset(const char* data, std::size_t size) {
+        m_fd = -1;
+        m_cur = data;
+        m_end = data + size;
+        m_eof = false;
+    }
+    // Returns false if the input ended before an integer could be read.
+    bool readInt(int& value) {
+        if (!skipSpaces())
+            return false;
+        bool negative = false;
+        if (*m_cur == '-' || *m_cur == '+') {
+            negative = *m_cur == '-';
+            ++m_cur;
+        }
+        int res = 0;
+        while (hasData() && static_cast<unsigned>(*m_cur - '0') < 10)
+            res = 10 * res + (*m_cur++ - '0');
+        value = negative ? -res : res;
+        return true;
+    }
+    int readInt() {
+        int value = 0;
+        readInt(value);
+        return value;
+    }
+    // Copies the next whitespace separated word into word (truncated and
+    // always null terminated), returns its length or 0 at end of input.
+    std::size_t readWord(char* word, std::size_t capacity) {
+        std::size_t length = 0;
+        if (!skipSpaces())
+            return (*word = '\0', 0);
+        while (hasData() && !isSpace(*m_cur)) {
+            if (length + 1 < capacity)
+                word[length++] = *m_cur;
+            ++m_cur;
+        }
+        word[length] = '\0';
+        return length;
+    }
+    bool eof() { return !skipSpaces(); }
+
+private:
+    static bool isSpace(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+    bool hasData() { return m_cur != m_end || refill(); }
+    bool skipSpaces() {
+        while (hasData()) {
+            if (!isSpace(*m_cur))
+                return true;
+            ++m_cur;
+        }
+        return false;
+    }
+    bool refill() {
+        if (m_fd < 0 || m_eof)
+            return false;
+        ssize_t n;
+        do {
+            n = ::read(m_fd, m_buffer, BUFFER_SIZE);
+        } while (n < 0 && errno == EINTR);
+        if (n <= 0) {
+            m_eof = true;
+            return false;
+        }
+        if (m_teeFd >= 0 && !writeAll(m_teeFd, m_buffer, n))
+            m_teeFd = -1; // the capture is lost, not the game
+        m_cur = m_buffer;
+        m_end = m_buffer + n;
+        return true;
+    }
+
+    int m_fd;
+    int m_teeFd;
+    const char* m_cur;
+    const char* m_end;
+    bool m_eof;
+    char m_buffer[BUFFER_SIZE];
+};
+
+class Writer {
+public:
+    static const std::size_t BUFFER_SIZE = 1 << 12;
+
+    // Writes to a file descriptor (stdout by default).
+    explicit Writer(int fd = 1)
+        : m_fd(fd), m_sink(nullptr), m_size(0) {}
+    // Appends every flushed turn to sink.
+    explicit Writer(std::string* sink)
+        : m_fd(-1), m_sink(sink), m_size(0) {}
+
+    Writer& operator<<(char c) {
+        reserve(1);
+        m_buffer[m_size++] = c;
+        return *this;
+    }
+    Writer& operator<<(const char* s) {
+        std::size_t length = std::strlen(s);
+        reserve(length);
+        std::memcpy(m_buffer + m_size, s, length);
+        m_size += length;
+        return *this;
+    }
+    Writer& operator<<(int value) {
+        char digits[12];
+        int n = 0;
+        unsigned u = value < 0 ? 0u - static_cast<unsigned>(value) : static_cast<unsigned>(value);
+        do {
+            digits[n++] = static_cast<char>('0' + u % 10);
+            u /= 10;
+        } while (u != 0);
+        reserve(n + 1);
+        if (value < 0)
+            m_buffer[m_size++] = '-';
+        while (n > 0)
+            m_buffer[m_size++] = digits[--n];
+        return *this;
+    }
+    // Sends everything pushed since the last flush at once.
+    void flush() {
+        if (m_sink != nullptr)
+            m_sink->append(m_buffer, m_size);
+        else
+            writeAll(m_fd, m_buffer, m_size);
+        m_size = 0;
+    }
+
+private:
+    void reserve(std::size_t n) {
+        if (m_size + n > BUFFER_SIZE)
+            flush();
+    }
+
+    int m_fd;
+    std::string* m_sink;
+    std::size_t m_size;
+    char m_buffer[BUFFER_SIZE];
+};
+
+} // namespace io
+
+#endif
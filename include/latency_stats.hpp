@@ -0,0 +1,81 @@
+#ifndef CODINGAME_LATENCY_STATS_HPP
+#define CODINGAME_LATENCY_STATS_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Latency histogram over nanoseconds with fixed storage.
+// Buckets are log-linear (8 per power of two) so recording is a handful of
+// instructions, nothing is allocated and percentiles are exact to 1/8th.
+class LatencyStats {
+public:
+    static const int NB_SUB_BUCKETS = 8;
+    static const int NB_BUCKETS = NB_SUB_BUCKETS + (64 - 3) * NB_SUB_BUCKETS;
+
+    LatencyStats() { clear(); }
+
+    void clear() {
+        std::fill(m_buckets, m_buckets + NB_BUCKETS, 0);
+        m_count = 0;
+        m_max = 0;
+        m_total = 0;
+    }
+    void record(std::uint64_t ns) {
+        ++m_buckets[bucketOf(ns)];
+        ++m_count;
+        m_max = std::max(m_max, ns);
+        m_total += ns;
+    }
+    void record(std::chrono::steady_clock::duration d) {
+        record(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()));
+    }
+    std::uint64_t count() const { return m_count; }
+    std::uint64_t max() const { return m_max; }
+    double mean() const { return m_count == 0 ? 0 : static_cast<double>(m_total) / m_count; }
+    // Upper bound of the bucket holding the p-th percentile (p in [0, 100]).
+    std::uint64_t percentile(double p) const {
+        if (m_count == 0)
+            return 0;
+        auto rank = static_cast<std::uint64_t>(p / 100 * (m_count - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (int b = 0; b < NB_BUCKETS; ++b) {
+            seen += m_buckets[b];
+            if (seen >= rank)
+                return std::min(upperBoundOf(b), m_max);
+        }
+        return m_max;
+    }
+    // One line: label, count, p50, p99 and max in microseconds.
+    void print(std::FILE* out, const char* label) const {
+        std::fprintf(out, "%-28s %10llu %10.2f %10.2f %10.2f\n", label, static_cast<unsigned long long>(m_count),
+            percentile(50) / 1e3, percentile(99) / 1e3, m_max / 1e3);
+    }
+    static void printHeader(std::FILE* out, const char* label) {
+        std::fprintf(out, "%-28s %10s %10s %10s %10s\n", label, "count", "p50(us)", "p99(us)", "max(us)");
+    }
+
+private:
+    static int bucketOf(std::uint64_t ns) {
+        if (ns < NB_SUB_BUCKETS)
+            return static_cast<int>(ns);
+        int e = 63 - __builtin_clzll(ns); // >= 3
+        int sub = static_cast<int>(ns >> (e - 3)) & (NB_SUB_BUCKETS - 1);
+        return NB_SUB_BUCKETS + (e - 3) * NB_SUB_BUCKETS + sub;
+    }
+    static std::uint64_t upperBoundOf(int b) {
+        if (b < NB_SUB_BUCKETS)
+            return b;
+        int e = (b - NB_SUB_BUCKETS) / NB_SUB_BUCKETS + 3;
+        std::uint64_t sub = (b - NB_SUB_BUCKETS) % NB_SUB_BUCKETS;
+        return ((NB_SUB_BUCKETS + sub + 1) << (e - 3)) - 1;
+    }
+
+    std::uint64_t m_buckets[NB_BUCKETS];
+    std::uint64_t m_count;
+    std::uint64_t m_max;
+    std::uint64_t m_total;
+};
+
+#endif
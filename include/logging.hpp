@@ -0,0 +1,167 @@
+#ifndef CODINGAME_LOGGING_HPP
+#define CODINGAME_LOGGING_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include <unistd.h>
+
+// Logging shared by the bots.
+// Records below LOG_LEVEL are compiled out (arguments are not even
+// evaluated). The others are stored as binary entries (format literal plus
+// raw arguments) in a preallocated ring buffer; nothing is formatted or
+// written until flush(), called once the turn's answer has been sent.
+// Formats use "{}" placeholders; string arguments must outlive the turn
+// (literals, static names).
+#define LOG_LEVEL_DEBUG   0
+#define LOG_LEVEL_INFO    1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_ERROR   3
+#define LOG_LEVEL_NONE    4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_AT(level, ...) \
+    do { \
+        if ((level) >= LOG_LEVEL) \
+            logging::trace().push((level), __VA_ARGS__); \
+    } while (false)
+#define LOG_DEBUG(...)   LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...)    LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT(LOG_LEVEL_WARNING, __VA_ARGS__)
+#define LOG_ERROR(...)   LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+namespace logging {
+
+class Trace {
+public:
+    static const std::size_t CAPACITY = 1 << 12; // records, power of 2
+    static const int NB_ARGS_MAX = 8;
+
+    explicit Trace(int fd = 2)
+        : m_fd(fd), m_records(new Record[CAPACITY]), m_head(0), m_size(0), m_nbDropped(0)
+    {
+        m_text.reserve(1 << 16);
+    }
+
+    // -1 discards everything (push becomes a no-op), e.g. for offline tools.
+    void setOutput(int fd) { m_fd = fd; }
+
+    template<typename... Args>
+    void push(int level, const char* format, const Args&... args) {
+        static_assert(sizeof...(Args) <= NB_ARGS_MAX, "too many log arguments");
+        if (m_fd < 0)
+            return;
+        if (m_size == CAPACITY) {
+            // overwrite the oldest record
+            m_head = (m_head + 1) & (CAPACITY - 1);
+            --m_size;
+            ++m_nbDropped;
+        }
+        Record& r = m_records[(m_head + m_size++) & (CAPACITY - 1)];
+        r.format = format;
+        r.level = level;
+        r.nbArgs = 0;
+        int expand[] = { 0, (r.args[r.nbArgs++] = Arg(args), 0)... };
+        (void)expand;
+    }
+    // Formats every pending record and writes them at once.
+    void flush() {
+        if (m_fd < 0 || (m_size == 0 && m_nbDropped == 0))
+            return;
+        m_text.clear();
+        if (m_nbDropped != 0) {
+            appendf("W [log] %zu records dropped\n", m_nbDropped);
+            m_nbDropped = 0;
+        }
+        for (; m_size != 0; --m_size, m_head = (m_head + 1) & (CAPACITY - 1))
+            format(m_records[m_head]);
+        const char* data = m_text.data();
+        std::size_t remaining = m_text.size();
+        while (remaining > 0) {
+            ssize_t n = ::write(m_fd, data, remaining);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            data += n;
+            remaining -= n;
+        }
+    }
+
+private:
+    struct Arg {
+        enum Type { Int, Double, String };
+        Arg() : type(Int), i(0) {}
+        template<typename T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, int>::type = 0>
+        Arg(T value) : type(Int), i(static_cast<long long>(value)) {}
+        template<typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+        Arg(T value) : type(Double), d(static_cast<double>(value)) {}
+        Arg(const char* value) : type(String), s(value) {}
+        Type type;
+        union {
+            long long i;
+            double d;
+            const char* s;
+        };
+    };
+    struct Record {
+        const char* format;
+        int level;
+        int nbArgs;
+        Arg args[NB_ARGS_MAX];
+    };
+
+    template<typename... Args>
+    void appendf(const char* format, Args... args) {
+        char buffer[64];
+        int n = std::snprintf(buffer, sizeof(buffer), format, args...);
+        m_text.append(buffer, std::min<std::size_t>(n, sizeof(buffer) - 1));
+    }
+    void format(const Record& r) {
+        static const char LEVELS[] = "DIWE";
+        m_text += LEVELS[r.level];
+        m_text += ' ';
+        int next = 0;
+        for (const char* c = r.format; *c != '\0'; ++c) {
+            if (c[0] == '{' && c[1] == '}' && next < r.nbArgs) {
+                const Arg& a = r.args[next++];
+                if (a.type == Arg::Int)
+                    appendf("%lld", a.i);
+                else if (a.type == Arg::Double)
+                    appendf("%g", a.d);
+                else
+                    m_text += a.s != nullptr ? a.s : "(null)";
+                ++c;
+            }
+            else
+                m_text += *c;
+        }
+        m_text += '\n';
+    }
+
+    int m_fd;
+    std::unique_ptr<Record[]> m_records;
+    std::size_t m_head;
+    std::size_t m_size;
+    std::size_t m_nbDropped;
+    std::string m_text;
+};
+
+// One trace per thread, so that bots played in parallel do not share it.
+inline Trace& trace() {
+    static thread_local Trace t;
+    return t;
+}
+
+} // namespace logging
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef CODINGAME_REPLAY_HPP
+#define CODINGAME_REPLAY_HPP
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "capture.hpp"
+#include "fast_io.hpp"
+#include "latency_stats.hpp"
+#include "logging.hpp"
+
+// Replay of a capture log through a bot, as fast as it can parse.
+// The bot reads the mapped log through getInput() and answers to
+// getOutput(); run() times every turn and keeps the commands of each one,
+// then reports the turn latencies and diffs the commands against a golden
+// file, so that a corpus of real games doubles as a regression test.
+//
+// usage: <driver> LOG [--golden FILE] [--update-golden] [--turns]
+class Replay {
+public:
+    Replay(int argc, char** argv, const char* bot)
+        : m_log(argc > 1 ? argv[1] : ""), m_in(nullptr, 0), m_out(&m_commands), m_updateGolden(false), m_printTurns(false), m_valid(false)
+    {
+        for (int i = 2; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--golden" && i + 1 < argc)
+                m_golden = argv[++i];
+            else if (arg == "--update-golden")
+                m_updateGolden = true;
+            else if (arg == "--turns")
+                m_printTurns = true;
+        }
+        if (argc < 2 || !m_log.isValid())
+            std::fprintf(stderr, "%s is not a capture log\n", argc > 1 ? argv[1] : "(none)");
+        else if (std::string(m_log.getBot()) != bot)
+            std::fprintf(stderr, "%s was captured by %s, not %s\n", argv[1], m_log.getBot(), bot);
+        else {
+            m_in.reset(m_log.getInput(), m_log.getInputSize());
+            m_valid = true;
+        }
+        // the decisions are what is timed, not their logs
+        logging::trace().setOutput(-1);
+    }
+
+    bool isValid() const { return m_valid; }
+    io::Reader& getInput() { return m_in; }
+    io::Writer& getOutput() { return m_out; }
+
+    // Calls playTurn() until it returns false (end of the log), then
+    // reports. Returns the exit status: 0, or 1 if the golden file differs.
+    template<typename F>
+    int run(F playTurn) {
+        typedef std::chrono::steady_clock Clock;
+        std::vector<std::uint64_t> times;
+        std::vector<std::size_t> ends; // end of each turn in m_commands
+        Clock::time_point start = Clock::now();
+        while (true) {
+            Clock::time_point t0 = Clock::now();
+            if (!playTurn())
+                break;
+            const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+            times.push_back(static_cast<std::uint64_t>(ns));
+            ends.push_back(m_commands.size());
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        LatencyStats stats;
+        for (std::size_t t = 0; t < times.size(); ++t) {
+            stats.record(times[t]);
+            if (m_printTurns)
+                std::printf("turn %4zu %10.1f us\n", t, times[t] / 1e3);
+        }
+        std::printf("%zu turns in %.3f ms (%.0f turns/s)\n", times.size(), seconds * 1e3, times.size() / seconds);
+        LatencyStats::printHeader(stdout, "replay");
+        stats.print(stdout, "turn");
+        return m_golden.empty() ? 0 : checkGolden(ends);
+    }
+
+private:
+    static std::vector<std::string> splitLines(const std::string& text, std::size_t begin, std::size_t end) {
+        std::vector<std::string> lines;
+        std::istringstream stream(text.substr(begin, end - begin));
+        for (std::string line; std::getline(stream, line);)
+            lines.push_back(line);
+        return lines;
+    }
+    int checkGolden(const std::vector<std::size_t>& ends) {
+        if (m_updateGolden) {
+            std::ofstream(m_golden, std::ios::binary) << m_commands;
+            std::printf("golden %s written\n", m_golden.c_str());
+            return 0;
+        }
+        std::ifstream file(m_golden, std::ios::binary);
+        if (!file) {
+            std::fprintf(stderr, "cannot open %s\n", m_golden.c_str());
+            return 1;
+        }
+        std::stringstream content;
+        content << file.rdbuf();
+        const std::string golden = content.str();
+        const std::vector<std::string> expected = splitLines(golden, 0, golden.size());
+        // a turn answers as many lines as the bot has units to command
+        std::size_t line = 0;
+        int nbDiffs = 0;
+        for (std::size_t t = 0; t < ends.size(); ++t) {
+            const std::vector<std::string> got = splitLines(m_commands, t == 0 ? 0 : ends[t - 1], ends[t]);
+            for (const std::string& g : got) {
+                const std::string e = line < expected.size() ? expected[line] : std::string("<end of golden>");
+                if (g != e && nbDiffs++ < 5)
+                    std::printf("turn %zu line %zu\n  expected %s\n  got      %s\n", t, line + 1, e.c_str(), g.c_str());
+                ++line;
+            }
+        }
+        if (line < expected.size()) {
+            std::printf("golden has %zu more lines\n", expected.size() - line);
+            ++nbDiffs;
+        }
+        std::printf("golden %s: %s (%d differences)\n", m_golden.c_str(), nbDiffs == 0 ? "identical" : "DIFFERENT", nbDiffs);
+        return nbDiffs == 0 ? 0 : 1;
+    }
+
+    capture::Log m_log;
+    io::Reader m_in;
+    std::string m_commands;
+    io::Writer m_out;
+    std::string m_golden;
+    bool m_updateGolden;
+    bool m_printTurns;
+    bool m_valid;
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef CODINGAME_TURN_PROFILER_HPP
+#define CODINGAME_TURN_PROFILER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#include "latency_stats.hpp"
+
+// Wall time of every turn of a bot split into parse / decide / emit.
+// A turn starts once its input is available (waiting for the referee is not
+// ours to optimize) and each mark() closes the phase running since the
+// previous mark. Phases go to fixed histograms; print() is meant for EOF.
+class TurnProfiler {
+public:
+    enum Phase {
+        Parse,
+        Decide,
+        Emit,
+        NB_PHASES
+    };
+
+    TurnProfiler() : m_nbTurns(0) {
+        for (int p = 0; p <= NB_PHASES; ++p) {
+            m_worst[p] = 0;
+            m_worstTurn[p] = -1;
+        }
+    }
+
+    void beginTurn() {
+        m_start = Clock::now();
+        m_last = m_start;
+    }
+    void mark(Phase phase) {
+        Clock::time_point now = Clock::now();
+        record(phase, now - m_last);
+        m_last = now;
+    }
+    // Records the whole turn, from beginTurn() to the last mark().
+    void endTurn() {
+        record(NB_PHASES, m_last - m_start);
+        ++m_nbTurns;
+    }
+    int getNbTurns() const { return m_nbTurns; }
+    // Latencies of phase, NB_PHASES for the whole turn.
+    const LatencyStats& getStats(int phase) const { return m_stats[phase]; }
+
+    // One line per phase plus the total: mean/p50/p95/p99/max in
+    // microseconds and the (0-based) turn that took the longest.
+    void print(std::FILE* out) const {
+        static const char* const NAMES[NB_PHASES + 1] = { "parse", "decide", "emit", "turn" };
+        std::fprintf(out, "%-8s %6s %9s %9s %9s %9s %9s %6s\n", "phase", "turns", "mean(us)", "p50(us)", "p95(us)", "p99(us)", "max(us)",
+            "worst");
+        for (int p = 0; p <= NB_PHASES; ++p) {
+            const LatencyStats& s = m_stats[p];
+            std::fprintf(out, "%-8s %6llu %9.2f %9.1f %9.1f %9.1f %9.1f %6d\n", NAMES[p], static_cast<unsigned long long>(s.count()),
+                s.mean() / 1e3, s.percentile(50) / 1e3, s.percentile(95) / 1e3, s.percentile(99) / 1e3, s.max() / 1e3, m_worstTurn[p]);
+        }
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    void record(int phase, Clock::duration d) {
+        const auto ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+        m_stats[phase].record(ns);
+        if (ns > m_worst[phase] || m_worstTurn[phase] < 0) {
+            m_worst[phase] = ns;
+            m_worstTurn[phase] = m_nbTurns;
+        }
+    }
+
+    // the extra entry is the whole turn
+    LatencyStats m_stats[NB_PHASES + 1];
+    std::uint64_t m_worst[NB_PHASES + 1];
+    int m_worstTurn[NB_PHASES + 1];
+    int m_nbTurns;
+    Clock::time_point m_start;
+    Clock::time_point m_last;
+};
+
+#endif
@@ -0,0 +1,171 @@
+#ifndef CODINGAME_WORK_STEALING_POOL_HPP
+#define CODINGAME_WORK_STEALING_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed set of worker threads running parallel loops over task indices.
+// Each worker owns a contiguous range of indices and pops from its front;
+// a worker that runs dry steals the back half of the busiest range, so an
+// uneven load (long rollouts, long matches) still keeps every core busy.
+// The calling thread takes part as worker 0, nothing is allocated per loop.
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(unsigned nbWorkers = std::thread::hardware_concurrency())
+        : m_nbWorkers(std::max(1u, nbWorkers))
+        , m_ranges(new Range[m_nbWorkers])
+        , m_generation(0)
+        , m_stop(false)
+        , m_invoke(nullptr)
+        , m_context(nullptr)
+        , m_nbRemaining(0)
+        , m_nbBusy(0)
+    {
+        for (unsigned i = 1; i < m_nbWorkers; ++i)
+            m_threads.emplace_back(&WorkStealingPool::run, this, i);
+    }
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wakeUp.notify_all();
+        for (auto& t : m_threads)
+            t.join();
+    }
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    unsigned size() const { return m_nbWorkers; }
+
+    // Calls f(workerId, index) for every index in [0, count), returns once all are done.
+    // workerId is in [0, size()) and is never used by two threads at the same time.
+    template<typename F>
+    void parallelFor(std::size_t count, F&& f) {
+        if (count == 0)
+            return;
+        for (unsigned i = 0; i < m_nbWorkers; ++i) {
+            std::lock_guard<std::mutex> lock(m_ranges[i].m_mutex);
+            m_ranges[i].m_begin = count * i / m_nbWorkers;
+            m_ranges[i].m_end = count * (i + 1) / m_nbWorkers;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_invoke = &invoke<typename std::remove_reference<F>::type>;
+            m_context = &f;
+            m_nbRemaining.store(count);
+            m_nbBusy = m_nbWorkers - 1;
+            ++m_generation;
+        }
+        m_wakeUp.notify_all();
+        work(0);
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_nbBusy == 0; });
+        m_invoke = nullptr;
+        m_context = nullptr;
+    }
+
+private:
+    struct alignas(64) Range {
+        Range() : m_begin(0), m_end(0) {}
+        std::mutex m_mutex;
+        std::size_t m_begin;
+        std::size_t m_end;
+    };
+    typedef void (*Invoke)(void*, unsigned, std::size_t);
+
+    template<typename F>
+    static void invoke(void* context, unsigned workerId, std::size_t index) {
+        (*static_cast<F*>(context))(workerId, index);
+    }
+    void run(unsigned workerId) {
+        std::size_t generation = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wakeUp.wait(lock, [&] { return m_stop || m_generation != generation; });
+                if (m_stop)
+                    return;
+                generation = m_generation;
+            }
+            work(workerId);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_nbBusy == 0)
+                m_done.notify_one();
+        }
+    }
+    void work(unsigned workerId) {
+        std::size_t index;
+        while (m_nbRemaining.load(std::memory_order_acquire) != 0) {
+            if (pop(workerId, index) || steal(workerId, index)) {
+                m_invoke(m_context, workerId, index);
+                m_nbRemaining.fetch_sub(1, std::memory_order_acq_rel);
+            }
+            else
+                std::this_thread::yield();
+        }
+    }
+    bool pop(unsigned workerId, std::size_t& index) {
+        Range& r = m_ranges[workerId];
+        std::lock_guard<std::mutex> lock(r.m_mutex);
+        if (r.m_begin == r.m_end)
+            return false;
+        index = r.m_begin++;
+        return true;
+    }
+    bool steal(unsigned workerId, std::size_t& index) {
+        // pick the victim with the most pending work
+        unsigned victim = workerId;
+        std::size_t most = 0;
+        for (unsigned i = 0; i < m_nbWorkers; ++i) {
+            if (i == workerId)
+                continue;
+            std::lock_guard<std::mutex> lock(m_ranges[i].m_mutex);
+            auto pending = m_ranges[i].m_end - m_ranges[i].m_begin;
+            if (pending > most) {
+                most = pending;
+                victim = i;
+            }
+        }
+        if (victim == workerId)
+            return false;
+        std::size_t begin, end;
+        {
+            Range& r = m_ranges[victim];
+            std::lock_guard<std::mutex> lock(r.m_mutex);
+            if (r.m_begin == r.m_end)
+                return false;
+            begin = r.m_begin + (r.m_end - r.m_begin) / 2;
+            end = r.m_end;
+            r.m_end = begin;
+        }
+        index = begin;
+        Range& own = m_ranges[workerId];
+        std::lock_guard<std::mutex> lock(own.m_mutex);
+        own.m_begin = begin + 1;
+        own.m_end = end;
+        return true;
+    }
+
+    const unsigned m_nbWorkers;
+    std::unique_ptr<Range[]> m_ranges;
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::condition_variable m_done;
+    std::size_t m_generation;
+    bool m_stop;
+    Invoke m_invoke;
+    void* m_context;
+    std::atomic<std::size_t> m_nbRemaining;
+    unsigned m_nbBusy;
+};
+
+#endif
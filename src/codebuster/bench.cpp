@@ -0,0 +1,169 @@
+// Benchmark of the buster to target assignment solver.
+// The solver is first checked against brute force on small random matrices
+// (exit status 2 on a wrong answer). Random cost matrices shaped like a turn of the assignment stage (busters x
+// {ghosts, carriers, exploration points}) from the stock 5 x 40 up to
+// scaled-up games, solved repeatedly; reports p50/p99/max per size.
+// Then the squared distance kernel (AVX2 unless built with CB_NO_AVX2)
+// against the plain loop, on runs as long as the grid spans of a turn.
+//
+// usage: code_buster_bench [--iterations N] [--seed S]
+#define CB_NO_MAIN
+#include "main_one_file.cpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "latency_stats.hpp"
+
+namespace {
+
+const int NB_KERNEL_CALLS = 100;
+
+// Cheapest assignment by trying every permutation of the columns.
+long long solveByBruteForce(const std::vector<int>& costs, int nbRows, int nbCols) {
+    std::vector<int> cols(nbCols);
+    std::iota(cols.begin(), cols.end(), 0);
+    long long best = std::numeric_limits<long long>::max();
+    do {
+        long long total = 0;
+        for (int r = 0; r < nbRows; ++r)
+            total += costs[r * nbCols + cols[r]];
+        best = std::min(best, total);
+    } while (std::next_permutation(cols.begin(), cols.end()));
+    return best;
+}
+
+// Solves nbMatrices random matrices of every small size, returns the number of wrong answers:
+// rowToCol not an injection, not costing the returned total, or the total not minimal.
+int checkAssignment(std::mt19937& rng, int nbMatrices) {
+    const int sizes[][2] = { { 1, 1 }, { 1, 4 }, { 2, 2 }, { 3, 6 }, { 4, 4 }, { 4, 7 }, { 5, 5 }, { 5, 8 } };
+    // as in DecisionEngine::assignTargets, forbidden pairings included
+    std::uniform_int_distribution<int> turns(0, 25), bonus(0, 150), forbidden(0, 9);
+    Assignment assignment;
+    int nbFailures = 0;
+    for (auto& size : sizes) {
+        const int nbRows = size[0];
+        const int nbCols = size[1];
+        std::vector<int> costs(nbRows * nbCols);
+        std::vector<int> rowToCol(nbRows);
+        for (int m = 0; m < nbMatrices; ++m) {
+            for (auto& c : costs)
+                c = forbidden(rng) == 0 ? DecisionEngine::FORBIDDEN_COST : 10 * turns(rng) - bonus(rng);
+            const long long total = assignment.solve(costs.data(), nbRows, nbCols, rowToCol.data());
+            long long cost = 0;
+            std::vector<bool> taken(nbCols, false);
+            bool isInjection = true;
+            for (int r = 0; r < nbRows; ++r) {
+                const int c = rowToCol[r];
+                isInjection = isInjection && c >= 0 && c < nbCols && !taken[c];
+                if (isInjection) {
+                    taken[c] = true;
+                    cost += costs[r * nbCols + c];
+                }
+            }
+            const long long best = solveByBruteForce(costs, nbRows, nbCols);
+            if (!isInjection || cost != total || total != best) {
+                if (nbFailures++ < 5)
+                    std::fprintf(stderr, "FAILED assignment %d x %d: solve %lld (rows cost %lld%s), brute force %lld\n", nbRows, nbCols, total, cost,
+                        isInjection ? "" : ", not an injection", best);
+            }
+        }
+    }
+    return nbFailures;
+}
+
+// The reference the kernel is measured against, kept scalar.
+__attribute__((noinline, optimize("no-tree-vectorize")))
+void distance2Scalar(int x, int y, const int* xs, const int* ys, int n, int* out) {
+    for (int i = 0; i < n; ++i) {
+        const int dx = xs[i] - x;
+        const int dy = ys[i] - y;
+        out[i] = dx * dx + dy * dy;
+    }
+}
+
+// Times batches of NB_KERNEL_CALLS calls of kernel, too short to time one by one.
+template<typename F>
+LatencyStats timeKernel(F kernel, const std::vector<int>& xs, const std::vector<int>& ys, std::vector<int>& out, int nbSamples, long long& sink) {
+    const int n = static_cast<int>(xs.size());
+    LatencyStats stats;
+    for (int it = 0; it < nbSamples; ++it) {
+        auto start = std::chrono::steady_clock::now();
+        for (int c = 0; c < NB_KERNEL_CALLS; ++c) {
+            kernel(c, it, xs.data(), ys.data(), n, out.data());
+            sink += out[c % n];
+        }
+        stats.record(std::chrono::steady_clock::now() - start);
+    }
+    return stats;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int nbIterations = 20000;
+    unsigned seed = 42;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--iterations")
+            nbIterations = std::max(1, std::atoi(argv[i + 1]));
+        else if (arg == "--seed")
+            seed = static_cast<unsigned>(std::atoi(argv[i + 1]));
+    }
+    const int sizes[][2] = { { 2, 16 }, { 3, 24 }, { 4, 32 }, { 5, 40 }, { 10, 80 }, { 20, 160 } };
+
+    std::mt19937 rng(seed);
+    const int nbFailures = checkAssignment(rng, std::max(1, nbIterations / 20));
+    if (nbFailures != 0) {
+        std::fprintf(stderr, "assignment: %d wrong answers against brute force\n", nbFailures);
+        return 2;
+    }
+    std::printf("assignment matches brute force\n\n");
+
+    // turns to reach (0..25) times 10 minus a bonus, as built by DecisionEngine::assignTargets
+    std::uniform_int_distribution<int> turns(0, 25), bonus(0, 150);
+    Assignment assignment;
+    long long sink = 0;
+    LatencyStats::printHeader(stdout, "busters x targets");
+    for (auto& size : sizes) {
+        const int nbRows = size[0];
+        const int nbCols = size[1];
+        std::vector<int> costs(nbRows * nbCols);
+        std::vector<int> rowToCol(nbRows);
+        LatencyStats stats;
+        for (int it = 0; it < nbIterations; ++it) {
+            for (auto& c : costs)
+                c = 10 * turns(rng) - bonus(rng);
+            auto start = std::chrono::steady_clock::now();
+            sink += assignment.solve(costs.data(), nbRows, nbCols, rowToCol.data());
+            stats.record(std::chrono::steady_clock::now() - start);
+        }
+        char label[32];
+        std::snprintf(label, sizeof(label), "%d x %d", nbRows, nbCols);
+        stats.print(stdout, label);
+    }
+
+    std::printf("\n");
+    char header[32];
+    std::snprintf(header, sizeof(header), "distance2 x n, %d calls", NB_KERNEL_CALLS);
+    LatencyStats::printHeader(stdout, header);
+    std::uniform_int_distribution<int> xDist(0, MAP_WIDTH), yDist(0, MAP_HEIGHT);
+    for (int n : { 8, 16, 40, 160 }) {
+        std::vector<int> xs(n), ys(n), out(n);
+        for (int i = 0; i < n; ++i) {
+            xs[i] = xDist(rng);
+            ys[i] = yDist(rng);
+        }
+        char label[32];
+        std::snprintf(label, sizeof(label), "kernel %d", n);
+        timeKernel(NavigationEngine::distance2Batch, xs, ys, out, nbIterations / 10, sink).print(stdout, label);
+        std::snprintf(label, sizeof(label), "scalar %d", n);
+        timeKernel(distance2Scalar, xs, ys, out, nbIterations / 10, sink).print(stdout, label);
+    }
+    return sink == 0 ? 1 : 0;
+}
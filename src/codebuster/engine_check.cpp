@@ -0,0 +1,118 @@
+// Scripted situations replayed on the headless referee, with their
+// expected outcome (run by ctest).
+#define CB_NO_MAIN
+#include "main_one_file.cpp"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "game_engine.hpp"
+
+namespace {
+
+int g_nbFailures = 0;
+
+void check(bool ok, const char* what) {
+    std::printf("%s %s\n", ok ? "ok    " : "FAILED", what);
+    g_nbFailures += !ok;
+}
+
+// Busters 0 (team 0) and 2 (team 1) stun each other in the same turn.
+void checkMutualStun() {
+    GameEngine engine(2, 8, 1);
+    engine.placeBuster(0, 5000, 4500);
+    engine.placeBuster(2, 5500, 4500);
+    engine.play("STUN 2\nMOVE 0 0\n", "STUN 0\nMOVE 16000 9000\n");
+    check(engine.getStunnedTurns(0) > 0 && engine.getStunnedTurns(2) > 0, "mutual stun stuns both busters");
+    // next turn, a stunned buster cannot stun
+    engine.play("MOVE 0 0\nSTUN 3\n", "MOVE 0 0\nMOVE 0 0\n");
+    engine.placeBuster(1, 5000, 4000);
+    engine.placeBuster(3, 5000, 4200);
+    engine.play("MOVE 0 0\nMOVE 5000 4000\n", "STUN 1\nMOVE 5000 4200\n");
+    check(engine.getStunnedTurns(1) == 0, "a stunned buster cannot stun");
+}
+
+// Self-play on the default setup: a buster closer than BUST_MIN_RADIUS to
+// the ghost it is assigned cannot bust it and must step out, it must not
+// stay that close two turns in a row. From right on the ghost stepping out
+// takes two moves: the buster only has to get farther. Turns it is stunned
+// or spends stunning do not count.
+void checkNoBusterStuckOnGhost() {
+    const int nbBusters = 3;
+    const int nbGhosts = 15;
+    int nbStuck = 0;
+    for (std::uint32_t seed = 1; seed <= 20; ++seed) {
+        GameEngine engine(nbBusters, nbGhosts, seed);
+        BotPlayer bots[2];
+        std::string input[2] = { engine.getInitInput(0), engine.getInitInput(1) };
+        std::vector<int> tooCloseTo(2 * nbBusters, -1); // ghost each buster was assigned and too close to
+        std::vector<int> distances2(2 * nbBusters, 0); // to that ghost
+        while (!engine.isOver()) {
+            std::string output[2];
+            for (int team = 0; team < 2; ++team) {
+                input[team] += engine.getTurnInput(team);
+                output[team] = bots[team].play(input[team]);
+                input[team].clear();
+                const DecisionEngine& dec = *bots[team].m_dec;
+                for (std::size_t r = 0; r < dec.m_busters0State.size(); ++r) {
+                    const int id = dec.m_busters0State[r].id;
+                    const DecisionEngine::Target& target = dec.m_targets[r];
+                    int ghostId = -1;
+                    int d2 = 0;
+                    if (target.type == DecisionEngine::Target::Ghost && engine.isGhostOnMap(target.id)) {
+                        const Buster& b = engine.getBuster(id);
+                        const Ghost& g = engine.getGhost(target.id);
+                        d2 = NavigationEngine::distance2(Point(b.x, b.y), Point(g.x, g.y));
+                        if (d2 < BUST_MIN_RADIUS * BUST_MIN_RADIUS)
+                            ghostId = target.id;
+                    }
+                    nbStuck += ghostId != -1 && tooCloseTo[id] == ghostId && d2 <= distances2[id];
+                    const bool isFree = engine.getStunnedTurns(id) == 0 && dec.m_busters0State[r].type != DecisionEngine::State::Stun;
+                    tooCloseTo[id] = isFree ? ghostId : -1;
+                    distances2[id] = d2;
+                }
+            }
+            engine.play(output[0], output[1]);
+        }
+    }
+    std::printf("%d buster-turns stuck too close to their ghost\n", nbStuck);
+    check(nbStuck == 0, "no buster stays within BUST_MIN_RADIUS of its assigned ghost");
+}
+
+// ReachTable against the plain formula: ceil((isqrt(d2) - range) / moves),
+// over random squared distances and around every threshold.
+void checkReachTable(const ReachTable& table, int range, const char* what) {
+    std::mt19937 rng(range);
+    std::uniform_int_distribution<int> randomDistance2(0, MAP_DIAGONAL * MAP_DIAGONAL);
+    std::vector<int> distances2;
+    for (int i = 0; i < 100000; ++i)
+        distances2.push_back(randomDistance2(rng));
+    for (int k = 0; k < ReachTable::MAX_TURNS; ++k) {
+        distances2.push_back(table.limits[k]);
+        distances2.push_back(table.limits[k] + 1);
+    }
+    int nbMismatches = 0;
+    for (int d2 : distances2) {
+        const int distance = static_cast<int>(std::sqrt(static_cast<double>(d2)));
+        const int naive = std::max(0, static_cast<int>(std::ceil(static_cast<double>(distance - range) / MOVE_PER_TURN)));
+        nbMismatches += table.turns(d2) != std::min(naive, ReachTable::MAX_TURNS - 1);
+    }
+    check(nbMismatches == 0, what);
+}
+
+} // namespace
+
+int main() {
+    logging::trace().setOutput(-1);
+    checkMutualStun();
+    checkNoBusterStuckOnGhost();
+    checkReachTable(g_exploreReach, 0, "g_exploreReach.turns() matches the plain formula");
+    checkReachTable(g_bustReach, BUST_MAX_RADIUS - 1, "g_bustReach.turns() matches the plain formula");
+    checkReachTable(g_stunReach, STUN_RADIUS - 1, "g_stunReach.turns() matches the plain formula");
+    check(g_bustReach.turns(BUST_MAX_RADIUS * BUST_MAX_RADIUS - 1) == 0 && g_bustReach.turns(BUST_MAX_RADIUS * BUST_MAX_RADIUS) == 1,
+        "g_bustReach is in range iff d2 < BUST_MAX_RADIUS^2");
+    return g_nbFailures == 0 ? 0 : 1;
+}
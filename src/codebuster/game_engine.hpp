@@ -0,0 +1,487 @@
+#ifndef CODE_BUSTER_GAME_ENGINE_HPP
+#define CODE_BUSTER_GAME_ENGINE_HPP
+
+// Headless Codebusters referee. Include after main_one_file.cpp (with
+// CB_NO_MAIN defined): it reuses the bot's Point / Buster / Ghost types and
+// map constants. Each player gets its referee input as text and answers
+// with the text its bot printed, so bots are driven through io::Reader /
+// io::Writer on memory buffers exactly as on the arena.
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct GameEngine {
+    static const int NB_TURNS_MAX = 400;
+    static const int MOVE_DISTANCE = 800;
+    static const int GHOST_FLEE_DISTANCE = 400;
+    static const int STUN_DURATION = 10;
+    static const int STUN_COOLDOWN = 20;
+    static const int BASE_SPREAD_RADIUS = 1500;
+
+    struct BusterInfo {
+        int team;
+        int carriedGhostId; // -1 if none
+        int stunnedTurns;
+        int cooldown;
+        bool busting;
+        int bustTargetId;
+    };
+    struct GhostInfo {
+        int stamina;
+        int nbAttackers;
+        bool onMap; // false once carried or delivered
+        bool delivered;
+    };
+
+    GameEngine(int bustersPerPlayer, int ghostCount, std::uint32_t seed)
+        : m_bustersPerPlayer(bustersPerPlayer)
+        , m_ghostCount(ghostCount)
+        , m_turn(0)
+        , m_rng(seed)
+    {
+        m_scores[0] = 0;
+        m_scores[1] = 0;
+        for (int team = 0; team < 2; ++team) {
+            for (int i = 0; i < bustersPerPlayer; ++i) {
+                const double angle = (i + 1) * 1.5707963267948966 / (bustersPerPlayer + 1);
+                int x = static_cast<int>(std::lround(BASE_SPREAD_RADIUS * std::cos(angle)));
+                int y = static_cast<int>(std::lround(BASE_SPREAD_RADIUS * std::sin(angle)));
+                if (team == 1) {
+                    x = g_home1.x - x;
+                    y = g_home1.y - y;
+                }
+                m_busters.push_back(Buster(team * bustersPerPlayer + i, x, y, Buster::State::Empty));
+                m_busterInfos.push_back(BusterInfo{ team, -1, 0, 0, false, -1 });
+            }
+        }
+        // mirrored pairs of ghosts away from the bases, one in the middle if odd
+        static const int STAMINAS[3] = { 3, 15, 40 };
+        std::uniform_int_distribution<int> rx(0, MAP_WIDTH - 1), ry(0, MAP_HEIGHT - 1), rs(0, 2);
+        for (int id = 0; id < ghostCount; ) {
+            if (ghostCount - id == 1) {
+                addGhost(id++, g_home1.x / 2, g_home1.y / 2, STAMINAS[2]);
+                continue;
+            }
+            const int x = rx(m_rng);
+            const int y = ry(m_rng);
+            if (NavigationEngine::distance2(Point(x, y), g_home0) < 3000 * 3000
+                || NavigationEngine::distance2(Point(x, y), g_home1) < 3000 * 3000)
+                continue;
+            const int stamina = STAMINAS[rs(m_rng)];
+            addGhost(id++, x, y, stamina);
+            addGhost(id++, g_home1.x - x, g_home1.y - y, stamina);
+        }
+    }
+
+    int getTurn() const { return m_turn; }
+    int getScore(int team) const { return m_scores[team]; }
+    // For scripted situations (engine_check).
+    void placeBuster(int id, int x, int y) {
+        m_busters[id].x = x;
+        m_busters[id].y = y;
+    }
+    int getStunnedTurns(int id) const { return m_busterInfos[id].stunnedTurns; }
+    const Buster& getBuster(int id) const { return m_busters[id]; }
+    const Ghost& getGhost(int id) const { return m_ghosts[id]; }
+    bool isGhostOnMap(int id) const { return m_ghostInfos[id].onMap; }
+    // -1 while playing or on a draw, else the winning team
+    int getWinner() const {
+        if (!isOver() || m_scores[0] == m_scores[1])
+            return -1;
+        return m_scores[0] > m_scores[1] ? 0 : 1;
+    }
+    bool isOver() const {
+        if (m_turn >= NB_TURNS_MAX || 2 * m_scores[0] > m_ghostCount || 2 * m_scores[1] > m_ghostCount)
+            return true;
+        return m_scores[0] + m_scores[1] == m_ghostCount;
+    }
+
+    // First lines a bot reads.
+    std::string getInitInput(int team) const {
+        return std::to_string(m_bustersPerPlayer) + '\n' + std::to_string(m_ghostCount) + '\n' + std::to_string(team) + '\n';
+    }
+    // Entities seen by team this turn: its own busters plus everything in their vision.
+    std::string getTurnInput(int team) const {
+        std::string body;
+        int nbEntities = 0;
+        for (std::size_t i = 0; i < m_busters.size(); ++i) {
+            const Buster& b = m_busters[i];
+            const BusterInfo& info = m_busterInfos[i];
+            if (info.team != team && !isSeenBy(team, b.x, b.y))
+                continue;
+            int state = Buster::State::Empty;
+            int value = -1;
+            if (info.stunnedTurns > 0) {
+                state = Buster::State::Stunned;
+                value = info.stunnedTurns;
+            }
+            else if (info.carriedGhostId != -1) {
+                state = Buster::State::Carry;
+                value = info.carriedGhostId;
+            }
+            else if (info.busting) {
+                state = Buster::State::Busting;
+                value = info.bustTargetId;
+            }
+            appendEntity(body, b.id, b.x, b.y, info.team, state, value);
+            ++nbEntities;
+        }
+        for (std::size_t i = 0; i < m_ghosts.size(); ++i) {
+            const Ghost& g = m_ghosts[i];
+            const GhostInfo& info = m_ghostInfos[i];
+            if (!info.onMap || !isSeenBy(team, g.x, g.y))
+                continue;
+            appendEntity(body, g.id, g.x, g.y, -1, info.stamina, info.nbAttackers);
+            ++nbEntities;
+        }
+        return std::to_string(nbEntities) + '\n' + body;
+    }
+
+    // Applies the answers of both bots (one line per buster, in id order) and advances one turn.
+    void play(const std::string& output0, const std::string& output1) {
+        std::vector<Order> orders(m_busters.size());
+        parseOrders(0, output0, orders);
+        parseOrders(1, output1, orders);
+        for (std::size_t i = 0; i < m_busters.size(); ++i)
+            m_busterInfos[i].busting = false;
+        for (auto& g : m_ghostInfos)
+            g.nbAttackers = 0;
+
+        // stuns are resolved on the state of the start of the turn: every
+        // legal stun is collected first, so that two busters stunning each
+        // other are both stunned whatever their ids
+        std::vector<std::pair<int, int> > stuns; // (stunner, target)
+        for (std::size_t i = 0; i < m_busters.size(); ++i) {
+            const BusterInfo& info = m_busterInfos[i];
+            const Order& o = orders[i];
+            if (o.type != Order::Stun || info.stunnedTurns > 0 || info.cooldown > 0)
+                continue;
+            const int target = o.arg0;
+            const bool inRange = target >= 0 && target < static_cast<int>(m_busters.size()) && target != static_cast<int>(i)
+                && NavigationEngine::distance2(point(m_busters[i]), point(m_busters[target])) <= STUN_RADIUS * STUN_RADIUS;
+            stuns.push_back(std::make_pair(static_cast<int>(i), inRange ? target : -1));
+        }
+        for (const auto& s : stuns) {
+            m_busterInfos[s.first].cooldown = STUN_COOLDOWN; // spent even on a miss
+            if (s.second != -1)
+                stun(s.second);
+        }
+        for (std::size_t i = 0; i < m_busters.size(); ++i) {
+            Buster& b = m_busters[i];
+            BusterInfo& info = m_busterInfos[i];
+            const Order& o = orders[i];
+            if (info.stunnedTurns > 0)
+                continue;
+            if (o.type == Order::Move)
+                moveTowards(b.x, b.y, o.arg0, o.arg1, MOVE_DISTANCE);
+            else if (o.type == Order::Release && info.carriedGhostId != -1)
+                release(i);
+            else if (o.type == Order::Bust && info.carriedGhostId == -1) {
+                const int g = o.arg0;
+                if (g < 0 || g >= static_cast<int>(m_ghosts.size()) || !m_ghostInfos[g].onMap)
+                    continue;
+                const int d2 = NavigationEngine::distance2(point(b), point(m_ghosts[g]));
+                if (!NavigationEngine::isInBustableRadius(d2))
+                    continue;
+                info.busting = true;
+                info.bustTargetId = g;
+                ++m_ghostInfos[g].nbAttackers;
+            }
+        }
+        resolveBusts();
+        fleeGhosts();
+        for (auto& info : m_busterInfos) {
+            if (info.stunnedTurns > 0)
+                --info.stunnedTurns;
+            if (info.cooldown > 0)
+                --info.cooldown;
+        }
+        ++m_turn;
+    }
+
+private:
+    struct Order {
+        enum Type { None, Move, Bust, Stun, Release };
+        Order() : type(None), arg0(0), arg1(0) {}
+        Type type;
+        int arg0;
+        int arg1;
+    };
+
+    static Point point(const Buster& b) { return Point(b.x, b.y); }
+    static Point point(const Ghost& g) { return Point(g.x, g.y); }
+    static void appendEntity(std::string& out, int id, int x, int y, int type, int state, int value) {
+        out += std::to_string(id) + ' ' + std::to_string(x) + ' ' + std::to_string(y) + ' ' + std::to_string(type) + ' '
+            + std::to_string(state) + ' ' + std::to_string(value) + '\n';
+    }
+    static void moveTowards(int& x, int& y, int tx, int ty, int distance) {
+        const double dx = tx - x;
+        const double dy = ty - y;
+        const double d = std::sqrt(dx * dx + dy * dy);
+        if (d <= distance) {
+            x = tx;
+            y = ty;
+        }
+        else {
+            x = static_cast<int>(std::lround(x + dx * distance / d));
+            y = static_cast<int>(std::lround(y + dy * distance / d));
+        }
+        x = std::max(0, std::min(MAP_WIDTH - 1, x));
+        y = std::max(0, std::min(MAP_HEIGHT - 1, y));
+    }
+
+    void addGhost(int id, int x, int y, int stamina) {
+        m_ghosts.push_back(Ghost(id, x, y));
+        m_ghostInfos.push_back(GhostInfo{ stamina, 0, true, false });
+    }
+    bool isSeenBy(int team, int x, int y) const {
+        for (std::size_t i = 0; i < m_busters.size(); ++i) {
+            if (m_busterInfos[i].team == team
+                && NavigationEngine::distance2(point(m_busters[i]), Point(x, y)) <= VISION_RADIUS * VISION_RADIUS)
+                return true;
+        }
+        return false;
+    }
+    void parseOrders(int team, const std::string& output, std::vector<Order>& orders) const {
+        const char* cur = output.c_str();
+        for (int i = 0; i < m_bustersPerPlayer && *cur != '\0'; ++i) {
+            Order& o = orders[team * m_bustersPerPlayer + i];
+            char* end;
+            if (std::strncmp(cur, "MOVE", 4) == 0) {
+                o.type = Order::Move;
+                o.arg0 = static_cast<int>(std::strtol(cur + 4, &end, 10));
+                o.arg1 = static_cast<int>(std::strtol(end, &end, 10));
+            }
+            else if (std::strncmp(cur, "BUST", 4) == 0) {
+                o.type = Order::Bust;
+                o.arg0 = static_cast<int>(std::strtol(cur + 4, &end, 10));
+            }
+            else if (std::strncmp(cur, "STUN", 4) == 0) {
+                o.type = Order::Stun;
+                o.arg0 = static_cast<int>(std::strtol(cur + 4, &end, 10));
+            }
+            else if (std::strncmp(cur, "RELEASE", 7) == 0)
+                o.type = Order::Release;
+            const char* eol = std::strchr(cur, '\n');
+            cur = eol != nullptr ? eol + 1 : cur + std::strlen(cur);
+        }
+    }
+    void stun(int target) {
+        BusterInfo& info = m_busterInfos[target];
+        info.stunnedTurns = STUN_DURATION;
+        info.busting = false;
+        if (info.carriedGhostId != -1)
+            drop(target);
+    }
+    // The carried ghost goes back on the map where the buster stands.
+    void drop(int busterIdx) {
+        BusterInfo& info = m_busterInfos[busterIdx];
+        Ghost& g = m_ghosts[info.carriedGhostId];
+        g.x = m_busters[busterIdx].x;
+        g.y = m_busters[busterIdx].y;
+        m_ghostInfos[info.carriedGhostId].onMap = true;
+        info.carriedGhostId = -1;
+    }
+    void release(int busterIdx) {
+        BusterInfo& info = m_busterInfos[busterIdx];
+        const Point& base = info.team == 0 ? g_home0 : g_home1;
+        if (NavigationEngine::distance2(point(m_busters[busterIdx]), base) <= DELIVERY_RADIUS * DELIVERY_RADIUS) {
+            m_ghostInfos[info.carriedGhostId].delivered = true;
+            ++m_scores[info.team];
+            info.carriedGhostId = -1;
+        }
+        else
+            drop(busterIdx);
+    }
+    // Every busting buster takes one stamina; at 0 the team with the most
+    // busters on the ghost catches it, nobody on a tie.
+    void resolveBusts() {
+        for (std::size_t g = 0; g < m_ghosts.size(); ++g) {
+            GhostInfo& ghost = m_ghostInfos[g];
+            if (ghost.nbAttackers == 0)
+                continue;
+            ghost.stamina = std::max(0, ghost.stamina - ghost.nbAttackers);
+            if (ghost.stamina > 0)
+                continue;
+            int count[2] = { 0, 0 };
+            int first[2] = { -1, -1 };
+            for (std::size_t i = 0; i < m_busters.size(); ++i) {
+                const BusterInfo& info = m_busterInfos[i];
+                if (info.busting && info.bustTargetId == static_cast<int>(g)) {
+                    if (count[info.team]++ == 0)
+                        first[info.team] = static_cast<int>(i);
+                }
+            }
+            if (count[0] == count[1])
+                continue;
+            const int catcher = first[count[0] > count[1] ? 0 : 1];
+            m_busterInfos[catcher].carriedGhostId = static_cast<int>(g);
+            ghost.onMap = false;
+        }
+    }
+    // Ghosts that were left alone run away from the closest buster in sight.
+    void fleeGhosts() {
+        for (std::size_t g = 0; g < m_ghosts.size(); ++g) {
+            GhostInfo& info = m_ghostInfos[g];
+            if (!info.onMap || info.nbAttackers > 0)
+                continue;
+            Ghost& ghost = m_ghosts[g];
+            int closest = -1;
+            int minDist2 = VISION_RADIUS * VISION_RADIUS + 1;
+            for (std::size_t i = 0; i < m_busters.size(); ++i) {
+                const int d2 = NavigationEngine::distance2(point(m_busters[i]), point(ghost));
+                if (d2 < minDist2) {
+                    minDist2 = d2;
+                    closest = static_cast<int>(i);
+                }
+            }
+            if (closest == -1 || minDist2 == 0)
+                continue;
+            const Buster& b = m_busters[closest];
+            moveTowards(ghost.x, ghost.y, 2 * ghost.x - b.x, 2 * ghost.y - b.y, GHOST_FLEE_DISTANCE);
+        }
+    }
+
+    int m_bustersPerPlayer;
+    int m_ghostCount;
+    int m_turn;
+    int m_scores[2];
+    std::mt19937 m_rng;
+    std::vector<Buster> m_busters; // index == id
+    std::vector<BusterInfo> m_busterInfos;
+    std::vector<Ghost> m_ghosts; // index == id
+    std::vector<GhostInfo> m_ghostInfos;
+};
+
+// One side of a match, fed with the referee text of each turn.
+struct IPlayer {
+    virtual ~IPlayer() {}
+    // input holds the init lines too on the first turn; returns the bot's answer.
+    virtual const std::string& play(const std::string& input) = 0;
+};
+
+// The bot of main_one_file.cpp, reading and writing memory buffers.
+struct BotPlayer : public IPlayer {
+    BotPlayer() : m_in(nullptr, 0), m_writer(&m_output) {}
+    virtual const std::string& play(const std::string& input) override {
+        m_output.clear();
+        m_in.reset(input.data(), input.size());
+        if (!m_kb) {
+            m_kb.reset(new KnowledgeBase(m_in));
+            m_kb->step();
+            m_dec.reset(new DecisionEngine(*m_kb, m_writer));
+        }
+        else
+            m_kb->step();
+        m_dec->step();
+        m_dec->flush();
+        logging::trace().flush();
+        return m_output;
+    }
+
+    io::Reader m_in;
+    std::string m_output;
+    io::Writer m_writer;
+    std::unique_ptr<KnowledgeBase> m_kb;
+    std::unique_ptr<DecisionEngine> m_dec;
+};
+
+// Reference opponent: each buster brings back what it carries, busts the
+// closest ghost in range or walks to the closest one in sight, and otherwise
+// sweeps a fixed patrol of the map; it never stuns.
+struct BaselinePlayer : public IPlayer {
+    BaselinePlayer() : m_in(nullptr, 0), m_writer(&m_output), m_bustersPerPlayer(0), m_myTeamId(0) {}
+    virtual const std::string& play(const std::string& input) override {
+        static const Point PATROL[] = { Point(8000, 4500), Point(13000, 2000), Point(3000, 7000), Point(13000, 7000), Point(3000, 2000) };
+        static const int NB_PATROL = sizeof(PATROL) / sizeof(PATROL[0]);
+        m_output.clear();
+        m_in.reset(input.data(), input.size());
+        if (m_bustersPerPlayer == 0) {
+            m_bustersPerPlayer = m_in.readInt();
+            m_in.readInt(); // ghost count
+            m_myTeamId = m_in.readInt();
+            for (int i = 0; i < m_bustersPerPlayer; ++i)
+                m_patrol.push_back(i % NB_PATROL);
+        }
+        m_mine.clear();
+        m_ghosts.clear();
+        const int nbEntities = m_in.readInt();
+        for (int i = 0; i < nbEntities; ++i) {
+            const int id = m_in.readInt();
+            const int x = m_in.readInt();
+            const int y = m_in.readInt();
+            const int type = m_in.readInt();
+            const int state = m_in.readInt();
+            m_in.readInt(); // value
+            if (type == -1)
+                m_ghosts.push_back(Ghost(id, x, y));
+            else if (type == m_myTeamId)
+                m_mine.push_back(Buster(id, x, y, static_cast<Buster::State::Type>(state)));
+        }
+        const Point& home = m_myTeamId == 0 ? g_home0 : g_home1;
+        for (std::size_t i = 0; i < m_mine.size(); ++i) {
+            const Buster& b = m_mine[i];
+            const Point at(b.x, b.y);
+            if (b.state == Buster::State::Carry) {
+                if (NavigationEngine::distance2(at, home) < DELIVERY_RADIUS * DELIVERY_RADIUS)
+                    m_writer << "RELEASE\n";
+                else
+                    m_writer << "MOVE " << home.x << ' ' << home.y << '\n';
+                continue;
+            }
+            const Ghost* closest = nullptr;
+            int minDist2 = std::numeric_limits<int>::max();
+            for (const Ghost& g : m_ghosts) {
+                const int d2 = NavigationEngine::distance2(at, Point(g.x, g.y));
+                if (d2 < minDist2) {
+                    minDist2 = d2;
+                    closest = &g;
+                }
+            }
+            if (closest != nullptr && NavigationEngine::isInBustableRadius(minDist2))
+                m_writer << "BUST " << closest->id << '\n';
+            else if (closest != nullptr)
+                m_writer << "MOVE " << closest->x << ' ' << closest->y << '\n';
+            else {
+                int& patrol = m_patrol[i];
+                if (NavigationEngine::distance2(at, PATROL[patrol]) < VISION_RADIUS * VISION_RADIUS / 4)
+                    patrol = (patrol + 1) % NB_PATROL;
+                m_writer << "MOVE " << PATROL[patrol].x << ' ' << PATROL[patrol].y << '\n';
+            }
+        }
+        m_writer.flush();
+        return m_output;
+    }
+
+    io::Reader m_in;
+    std::string m_output;
+    io::Writer m_writer;
+    int m_bustersPerPlayer;
+    int m_myTeamId;
+    std::vector<int> m_patrol; // next patrol point of each buster
+    std::vector<Buster> m_mine;
+    std::vector<Ghost> m_ghosts;
+};
+
+// Plays engine to the end, returns the winning team or -1 on a draw.
+inline int playMatch(GameEngine& engine, IPlayer& player0, IPlayer& player1) {
+    std::string input[2] = { engine.getInitInput(0), engine.getInitInput(1) };
+    while (!engine.isOver()) {
+        input[0] += engine.getTurnInput(0);
+        input[1] += engine.getTurnInput(1);
+        const std::string& output0 = player0.play(input[0]);
+        const std::string& output1 = player1.play(input[1]);
+        engine.play(output0, output1);
+        input[0].clear();
+        input[1].clear();
+    }
+    return engine.getWinner();
+}
+
+#endif
@@ -1,13 +1,35 @@
+// the arena takes no compiler flags; PGO builds must not mix this pragma
+// with their profile flags (gcc then sees a different control flow)
+#ifndef CG_NO_OPTIMIZE_PRAGMA
+#pragma GCC optimize("O3")
+#endif
+// the distance kernels are AVX2 (the arena has it). g++ does not define
+// __AVX2__ after the pragma, hence CB_AVX2; -DCB_NO_AVX2 for older CPUs.
+#if defined(__x86_64__) && !defined(CB_NO_AVX2)
+#pragma GCC target("avx2")
+#define CB_AVX2
+#endif
+
 
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <cstdlib>
-#include <ctime>
 #include <iostream>
-#include <set>
+#include <limits>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
+#ifdef CB_AVX2
+#include <immintrin.h>
+#endif
+
+#include "assignment.hpp"
+#include "capture.hpp"
+#include "fast_io.hpp"
+#include "logging.hpp"
+#include "turn_profiler.hpp"
+
 using namespace std;
 
 // REPERE (0-1600,0-9000)
@@ -25,49 +47,52 @@ static const int BUST_MIN_RADIUS    = 900;
 static const int BUST_MAX_RADIUS    = 1760;
 static const int MAP_WIDTH          = 16001;
 static const int MAP_HEIGHT         = 9001;
+static const int VISION_RADIUS      = 2200;
+static const int MOVE_PER_TURN      = 800;
+
+// Floor of the square root, usable in constant expressions.
+constexpr int isqrt(long long n) {
+    long long r = 0;
+    for (long long bit = 1 << 15; bit != 0; bit >>= 1) {
+        if ((r + bit) * (r + bit) <= n)
+            r += bit;
+    }
+    return static_cast<int>(r);
+}
+static constexpr int MAP_DIAGONAL = isqrt((MAP_WIDTH - 1) * (MAP_WIDTH - 1) + (MAP_HEIGHT - 1) * (MAP_HEIGHT - 1));
+
+// Moves needed to get within range of a point, from its squared distance.
+// The squared thresholds are computed by the compiler: after k moves we are
+// in range iff isqrt(d2) <= range + k moves, i.e. d2 <= limits[k]. Built
+// with radius - 1, this is the referee's strict d2 < (radius + k moves)^2.
+struct ReachTable {
+    static constexpr int MAX_TURNS = (MAP_DIAGONAL + MOVE_PER_TURN - 1) / MOVE_PER_TURN + 1;
+
+    constexpr explicit ReachTable(int range) : limits() {
+        for (int k = 0; k < MAX_TURNS; ++k)
+            limits[k] = (range + MOVE_PER_TURN * k + 1) * (range + MOVE_PER_TURN * k + 1) - 1;
+    }
+    int turns(int distance2) const {
+        return static_cast<int>(std::lower_bound(limits, limits + MAX_TURNS - 1, distance2) - limits);
+    }
+    int limits[MAX_TURNS];
+};
+static constexpr ReachTable g_exploreReach(0);
+static constexpr ReachTable g_bustReach(BUST_MAX_RADIUS - 1);
+static constexpr ReachTable g_stunReach(STUN_RADIUS - 1);
 
 // KEYPOINT
 struct Point {
-    explicit Point(int x = 0, int y = 0, int id = -1) : x(x), y(y), id(id) {}
+    constexpr explicit Point(int x = 0, int y = 0, int id = -1) : x(x), y(y), id(id) {}
     int x;
     int y;
     int id;
 };
 
-static const Point g_home0 = Point(0, 0);
-static const Point g_home1 = Point(16000, 9000);
-static const Point g_camp_home0 = Point( 1100, 1100);
-static const Point g_camp_home1 = Point(14900, 7900);
-
-static const std::size_t NB_KEYPOINTS = 16;
-
-//     0   1       2       3
-//  7      6       5         4
-//  8      9      10        11
-//   15   14      13      12
-static const Point g_keypoints[NB_KEYPOINTS] = {
-    Point( 1100, 1100, 0),
-    Point( 5500, 1100, 1),
-    Point(10000, 1100, 2),
-    Point(14900, 1100, 3),
-    //
-    Point(14900, 4000, 4),
-    Point(10000, 4000, 5),
-    Point( 5500, 4000, 6),
-    Point( 1100, 4000, 7),
-    
-    //
-    Point( 1100, 6500, 8),
-    Point( 5500, 6500, 9),
-    Point(10000, 6500, 10),
-    Point(14900, 6500, 11),
-    //
-    Point(14900, 8900, 12),
-    Point(10000, 8900, 13),
-    Point( 5500, 8900, 14),
-    Point( 1100, 8900, 15),
-    
-};
+static constexpr Point g_home0 = Point(0, 0);
+static constexpr Point g_home1 = Point(16000, 9000);
+static constexpr Point g_camp_home0 = Point( 1100, 1100);
+static constexpr Point g_camp_home1 = Point(14900, 7900);
 
 struct Buster {
     struct State {
@@ -122,96 +147,442 @@ struct Ghost {
     int y;
 };
 
+// Entities seen this turn bucketed by map cell, stored contiguously cell
+// after cell (CSR layout) as structure of arrays so that distance kernels
+// can stream the coordinates. Rebuilt by a counting sort in O(entities) per
+// turn; with cells as large as the biggest action radius, a radius query
+// only visits the 3x3 cells around the querier.
+struct UniformGrid {
+    static const int CELL_SIZE = BUST_MAX_RADIUS; // == STUN_RADIUS
+    static const int NB_COLS = (MAP_WIDTH + CELL_SIZE - 1) / CELL_SIZE;
+    static const int NB_ROWS = (MAP_HEIGHT + CELL_SIZE - 1) / CELL_SIZE;
+    static const int NB_CELLS = NB_COLS * NB_ROWS;
+
+    void clear() {
+        m_pendingIds.clear();
+        m_pendingXs.clear();
+        m_pendingYs.clear();
+    }
+    void insert(int id, int x, int y) {
+        m_pendingIds.push_back(id);
+        m_pendingXs.push_back(x);
+        m_pendingYs.push_back(y);
+    }
+    void build() {
+        const int n = static_cast<int>(m_pendingIds.size());
+        std::fill(m_offsets, m_offsets + NB_CELLS + 1, 0);
+        for (int i = 0; i < n; ++i)
+            ++m_offsets[cellOf(m_pendingXs[i], m_pendingYs[i]) + 1];
+        for (int c = 0; c < NB_CELLS; ++c)
+            m_offsets[c + 1] += m_offsets[c];
+        m_ids.resize(n);
+        m_xs.resize(n);
+        m_ys.resize(n);
+        int cursor[NB_CELLS];
+        std::copy(m_offsets, m_offsets + NB_CELLS, cursor);
+        for (int i = 0; i < n; ++i) {
+            int k = cursor[cellOf(m_pendingXs[i], m_pendingYs[i])]++;
+            m_ids[k] = m_pendingIds[i];
+            m_xs[k] = m_pendingXs[i];
+            m_ys[k] = m_pendingYs[i];
+        }
+    }
+    int size() const { return static_cast<int>(m_ids.size()); }
+    const int* ids() const { return m_ids.data(); }
+    const int* xs() const { return m_xs.data(); }
+    const int* ys() const { return m_ys.data(); }
+    // Calls f(first, last) for every run of entries [first, last) of the cells
+    // overlapping the square of half side radius around (x, y); the exact
+    // distance test is up to f.
+    template<typename F>
+    void forEachSpan(int x, int y, int radius, F&& f) const {
+        const int col0 = clampCol((x - radius) / CELL_SIZE);
+        const int col1 = clampCol((x + radius) / CELL_SIZE);
+        const int row0 = clampRow((y - radius) / CELL_SIZE);
+        const int row1 = clampRow((y + radius) / CELL_SIZE);
+        for (int row = row0; row <= row1; ++row) {
+            const int first = m_offsets[row * NB_COLS + col0];
+            const int last = m_offsets[row * NB_COLS + col1 + 1];
+            if (first != last)
+                f(first, last);
+        }
+    }
+private:
+    static int clampCol(int col) { return std::max(0, std::min(NB_COLS - 1, col)); }
+    static int clampRow(int row) { return std::max(0, std::min(NB_ROWS - 1, row)); }
+    static int cellOf(int x, int y) { return clampRow(y / CELL_SIZE) * NB_COLS + clampCol(x / CELL_SIZE); }
+
+    std::vector<int> m_pendingIds;
+    std::vector<int> m_pendingXs;
+    std::vector<int> m_pendingYs;
+    std::vector<int> m_ids;
+    std::vector<int> m_xs;
+    std::vector<int> m_ys;
+    int m_offsets[NB_CELLS + 1];
+};
+
+// Coarse belief that a ghost stands in each cell of the map. Every turn it
+// decays towards a prior (ghosts we stopped seeing may have moved, unseen
+// areas may hold some), is cleared inside our busters' vision and raised
+// where ghosts are seen. Visibility is a bitset, the decay a flat loop over
+// a padded float array the compiler vectorizes.
+struct FogMap {
+    static const int CELL_SIZE = 1000;
+    static const int NB_COLS = (MAP_WIDTH + CELL_SIZE - 1) / CELL_SIZE;
+    static const int NB_ROWS = (MAP_HEIGHT + CELL_SIZE - 1) / CELL_SIZE;
+    static const int NB_CELLS = NB_COLS * NB_ROWS;
+    static const int NB_CELLS_PADDED = (NB_CELLS + 7) & ~7;
+    static const int NB_WORDS = (NB_CELLS + 63) / 64;
+
+    // Cell centers as floats for the scoring loop, computed by the compiler.
+    struct Tables {
+        constexpr Tables() : centerXs(), centerYs() {
+            for (int c = 0; c < NB_CELLS_PADDED; ++c) {
+                // padding cells are parked far away so that they never win
+                centerXs[c] = c < NB_CELLS ? centerX(c) : 1e9f;
+                centerYs[c] = c < NB_CELLS ? centerY(c) : 1e9f;
+            }
+        }
+        alignas(32) float centerXs[NB_CELLS_PADDED];
+        alignas(32) float centerYs[NB_CELLS_PADDED];
+    };
+    static const Tables TABLES;
+
+    FogMap() {
+        std::fill(m_belief, m_belief + NB_CELLS_PADDED, 0.f);
+        std::fill(m_belief, m_belief + NB_CELLS, PRIOR);
+        std::fill(m_visible, m_visible + NB_WORDS, 0);
+    }
+    // Start of turn: forget a bit, then everything in sight is known empty until a ghost is seen.
+    void beginTurn() {
+        for (int c = 0; c < NB_CELLS_PADDED; ++c)
+            m_belief[c] = m_belief[c] * DECAY + (1.f - DECAY) * PRIOR;
+        std::fill(m_visible, m_visible + NB_WORDS, 0);
+    }
+    // Marks the cells whose center is in the vision of a buster at (x, y).
+    void see(int x, int y) {
+        const int row0 = std::max(0, (y - VISION_RADIUS) / CELL_SIZE);
+        const int row1 = std::min(NB_ROWS - 1, (y + VISION_RADIUS) / CELL_SIZE);
+        for (int row = row0; row <= row1; ++row) {
+            const int dy = row * CELL_SIZE + CELL_SIZE / 2 - y;
+            const int reach2 = VISION_RADIUS * VISION_RADIUS - dy * dy;
+            if (reach2 < 0)
+                continue;
+            const int reach = static_cast<int>(std::sqrt(static_cast<double>(reach2)));
+            const int col0 = std::max(0, (x - reach) / CELL_SIZE - 1);
+            const int col1 = std::min(NB_COLS - 1, (x + reach) / CELL_SIZE + 1);
+            for (int col = col0; col <= col1; ++col) {
+                if (std::abs(col * CELL_SIZE + CELL_SIZE / 2 - x) > reach)
+                    continue;
+                const int c = row * NB_COLS + col;
+                m_visible[c >> 6] |= std::uint64_t(1) << (c & 63);
+            }
+        }
+    }
+    // End of parse: clear what we saw, then raise the cells holding the ghosts seen this turn.
+    void endTurn(const int* ghostXs, const int* ghostYs, int nbGhosts) {
+        for (int w = 0; w < NB_WORDS; ++w) {
+            for (std::uint64_t bits = m_visible[w]; bits != 0; bits &= bits - 1)
+                m_belief[64 * w + __builtin_ctzll(bits)] = 0.f;
+        }
+        for (int i = 0; i < nbGhosts; ++i)
+            m_belief[cellOf(ghostXs[i], ghostYs[i])] = 1.f;
+    }
+    bool isVisible(int c) const { return (m_visible[c >> 6] >> (c & 63)) & 1; }
+    float getBelief(int c) const { return m_belief[c]; }
+    // Best cell to explore from (x, y): belief minus a travel penalty, cells in
+    // excluded (bitset, may be null) are skipped. Returns the cell center, id = cell.
+    Point bestTarget(int x, int y, const std::uint64_t* excluded = nullptr) const {
+        float scores[NB_CELLS_PADDED];
+        const float fx = static_cast<float>(x);
+        const float fy = static_cast<float>(y);
+        for (int c = 0; c < NB_CELLS_PADDED; ++c)
+            scores[c] = m_belief[c] - (std::fabs(TABLES.centerXs[c] - fx) + std::fabs(TABLES.centerYs[c] - fy)) * (1.f / DISTANCE_SCALE);
+        if (excluded != nullptr) {
+            for (int w = 0; w < NB_WORDS; ++w) {
+                for (std::uint64_t bits = excluded[w]; bits != 0; bits &= bits - 1)
+                    scores[64 * w + __builtin_ctzll(bits)] = -std::numeric_limits<float>::max();
+            }
+        }
+        const int best = static_cast<int>(std::max_element(scores, scores + NB_CELLS) - scores);
+        return Point(centerX(best), centerY(best), best);
+    }
+    static constexpr int cellOf(int x, int y) {
+        const int col = std::max(0, std::min(NB_COLS - 1, x / CELL_SIZE));
+        const int row = std::max(0, std::min(NB_ROWS - 1, y / CELL_SIZE));
+        return row * NB_COLS + col;
+    }
+    static constexpr int centerX(int c) { return std::min(MAP_WIDTH - 1, (c % NB_COLS) * CELL_SIZE + CELL_SIZE / 2); }
+    static constexpr int centerY(int c) { return std::min(MAP_HEIGHT - 1, (c / NB_COLS) * CELL_SIZE + CELL_SIZE / 2); }
+
+private:
+    static constexpr float PRIOR = 0.2f;
+    static constexpr float DECAY = 0.98f;
+    static constexpr float DISTANCE_SCALE = 20000.f; // travel distance worth a whole seen ghost
+
+    alignas(32) float m_belief[NB_CELLS_PADDED];
+    std::uint64_t m_visible[NB_WORDS];
+};
+constexpr FogMap::Tables FogMap::TABLES;
+
+// Last known state of every entity of one kind, indexed by id (ids are small
+// and dense) as structure of arrays. Sized once from the game header, so a
+// turn neither allocates nor hashes; what was seen this turn is a bitmask
+// cleared by beginTurn().
+struct EntityTable {
+    static constexpr int NEVER_SEEN = -1;
+
+    void resize(int size) {
+        m_xs.resize(size, 0);
+        m_ys.resize(size, 0);
+        m_states.resize(size, 0);
+        m_values.resize(size, 0);
+        m_lastSeen.resize(size, NEVER_SEEN);
+        m_visible.resize((size + 63) / 64, 0);
+    }
+    void beginTurn() { std::fill(m_visible.begin(), m_visible.end(), 0); }
+    void update(int id, int x, int y, int state, int value, int turn) {
+        if (id >= size())
+            resize(id + 1); // only if the header lied about the counts
+        m_xs[id] = x;
+        m_ys[id] = y;
+        m_states[id] = state;
+        m_values[id] = value;
+        m_lastSeen[id] = turn;
+        m_visible[id >> 6] |= std::uint64_t(1) << (id & 63);
+    }
+    int size() const { return static_cast<int>(m_lastSeen.size()); }
+    bool isKnown(int id) const { return id >= 0 && id < size() && m_lastSeen[id] != NEVER_SEEN; }
+    bool isVisible(int id) const { return id >= 0 && id < size() && (m_visible[id >> 6] >> (id & 63)) & 1; }
+    int getX(int id) const { return m_xs[id]; }
+    int getY(int id) const { return m_ys[id]; }
+    int getState(int id) const { return m_states[id]; }
+    int getValue(int id) const { return m_values[id]; }
+    int getLastSeen(int id) const { return m_lastSeen[id]; }
+private:
+    std::vector<int> m_xs;
+    std::vector<int> m_ys;
+    std::vector<int> m_states;
+    std::vector<int> m_values;
+    std::vector<int> m_lastSeen;
+    std::vector<std::uint64_t> m_visible;
+};
+
+// Recent sightings of every ennemy buster. An ennemy carrying a ghost heads
+// for its base, so its path is extrapolated along that line, at the speed
+// seen since it loaded the ghost (full speed until we have two sightings),
+// for HORIZON turns or until it can release. Paths are stored as structure
+// of arrays, one row of HORIZON positions per tracked carrier.
+struct EnnemyTracker {
+    static constexpr int HISTORY = 4; // sightings kept per ennemy
+    static constexpr int HORIZON = 16; // turns of extrapolated path
+    static_assert(HORIZON <= ReachTable::MAX_TURNS, "intercepts are checked against g_stunReach");
+    static constexpr int MAX_STALENESS = 5; // turns a carrier out of sight is still followed
+
+    struct Sighting {
+        int turn;
+        int x;
+        int y;
+        int state;
+    };
+
+    void initialize(int nbBusters, const Point& base) {
+        m_base = base;
+        m_sightings.assign(nbBusters * HISTORY, Sighting{ EntityTable::NEVER_SEEN, 0, 0, 0 });
+        m_nbSightings.assign(nbBusters, 0);
+        m_ids.reserve(nbBusters);
+        m_arrivals.reserve(nbBusters);
+        m_xs.reserve(nbBusters * HORIZON);
+        m_ys.reserve(nbBusters * HORIZON);
+    }
+    void see(int id, int x, int y, int state, int turn) {
+        if (id >= static_cast<int>(m_nbSightings.size()))
+            return;
+        m_sightings[id * HISTORY + m_nbSightings[id] % HISTORY] = Sighting{ turn, x, y, state };
+        ++m_nbSightings[id];
+    }
+    // Rebuilds the tracked carriers and their paths as of turn.
+    void update(int turn) {
+        m_ids.clear();
+        m_arrivals.clear();
+        m_xs.clear();
+        m_ys.clear();
+        for (int id = 0; id < static_cast<int>(m_nbSightings.size()); ++id) {
+            if (m_nbSightings[id] == 0)
+                continue;
+            const Sighting& last = getSighting(id, 0);
+            const int elapsed = turn - last.turn;
+            if (last.state != Buster::State::Carry || elapsed > MAX_STALENESS)
+                continue;
+            const double dx = m_base.x - last.x;
+            const double dy = m_base.y - last.y;
+            const double length = std::sqrt(dx * dx + dy * dy);
+            const double remaining = length - (DELIVERY_RADIUS - 1);
+            const double speed = getSpeed(id, length);
+            const int arrival = remaining <= 0 ? -elapsed
+                : speed <= 0 ? HORIZON : static_cast<int>(std::ceil(remaining / speed)) - elapsed;
+            if (arrival < 0)
+                continue; // already released
+            m_ids.push_back(id);
+            m_arrivals.push_back(std::min(arrival, HORIZON - 1));
+            for (int t = 0; t < HORIZON; ++t) {
+                const double progress = length <= 0 ? 0 : std::max(0.0, std::min(remaining, speed * (elapsed + t))) / length;
+                m_xs.push_back(last.x + static_cast<int>(dx * progress));
+                m_ys.push_back(last.y + static_cast<int>(dy * progress));
+            }
+        }
+    }
+    int getNbCarriers() const { return static_cast<int>(m_ids.size()); }
+    int getId(int k) const { return m_ids[k]; }
+    // Last turn (from now) the carrier can still be stunned before releasing.
+    int getArrival(int k) const { return m_arrivals[k]; }
+    const int* pathXs(int k) const { return m_xs.data() + k * HORIZON; }
+    const int* pathYs(int k) const { return m_ys.data() + k * HORIZON; }
+    Point getPosition(int k, int t) const { return Point(pathXs(k)[t], pathYs(k)[t]); }
+private:
+    // age 0 is the latest sighting
+    const Sighting& getSighting(int id, int age) const {
+        return m_sightings[id * HISTORY + (m_nbSightings[id] - 1 - age) % HISTORY];
+    }
+    // Mean progress towards the base per turn over the sightings since the
+    // ghost was loaded, capped to a move.
+    double getSpeed(int id, double length) const {
+        const int nbSightings = std::min(m_nbSightings[id], HISTORY);
+        int age = 1;
+        while (age < nbSightings && getSighting(id, age).state == Buster::State::Carry)
+            ++age;
+        if (age == 1)
+            return MOVE_PER_TURN;
+        const Sighting& first = getSighting(id, age - 1);
+        const Sighting& last = getSighting(id, 0);
+        const double fx = m_base.x - first.x;
+        const double fy = m_base.y - first.y;
+        const double progress = std::sqrt(fx * fx + fy * fy) - length;
+        return std::max(0.0, std::min<double>(MOVE_PER_TURN, progress / (last.turn - first.turn)));
+    }
+
+    Point m_base;
+    std::vector<Sighting> m_sightings; // HISTORY per ennemy, ring indexed by m_nbSightings
+    std::vector<int> m_nbSightings;
+    std::vector<int> m_ids;
+    std::vector<int> m_arrivals;
+    std::vector<int> m_xs;
+    std::vector<int> m_ys;
+};
+
 struct KnowledgeBase {
     int m_myTeamId;
     int m_bustersPerPlayer;
     int m_ghostCount;
+    int m_turn;
     
-    std::unordered_map<int, Ghost>  m_ghosts;
-    std::unordered_map<int, Buster> m_busters0;
-    std::unordered_map<int, Buster> m_busters1;
+    EntityTable       m_ghosts;
+    EntityTable       m_busters; // both teams, ours are m_allyIds
+    std::vector<int>  m_allyIds;
+    EnnemyTracker     m_tracker;
     
-    std::set<Ghost>   m_currentGhosts;
-    std::set<Buster>  m_currentEnnemies;
+    UniformGrid       m_ghostGrid;
+    UniformGrid       m_ennemyGrid;
+    FogMap            m_fog;
 
-    KnowledgeBase()
+    io::Reader& m_in;
+
+    explicit KnowledgeBase(io::Reader& in)
+        : m_turn(0)
+        , m_in(in)
     {
         // the amount of busters you control
-        cin >> m_bustersPerPlayer; cin.ignore();
+        m_bustersPerPlayer = m_in.readInt();
         // the amount of ghosts on the map
-        cin >> m_ghostCount; cin.ignore();
+        m_ghostCount = m_in.readInt();
         // if this is 0, your base is on the top left of the map, if it is one, on the bottom right
-        cin >> m_myTeamId; cin.ignore();
+        m_myTeamId = m_in.readInt();
+        m_ghosts.resize(m_ghostCount);
+        m_busters.resize(2 * m_bustersPerPlayer);
+        m_allyIds.reserve(m_bustersPerPlayer);
+        m_tracker.initialize(2 * m_bustersPerPlayer, m_myTeamId == 0 ? g_home1 : g_home0);
+    }
+    Buster getBuster(int id) const {
+        return Buster(id, m_busters.getX(id), m_busters.getY(id), static_cast<Buster::State::Type>(m_busters.getState(id)));
     }
-    void step() {
-        std::cerr << "[kb] ===============" << std::endl; 
-        m_currentGhosts.clear();
-        m_currentEnnemies.clear();
+    // Returns false once the referee closed the input.
+    bool step() {
+        LOG_DEBUG("[kb] ===============");
+        ++m_turn;
+        m_ghosts.beginTurn();
+        m_busters.beginTurn();
+        m_ghostGrid.clear();
+        m_ennemyGrid.clear();
         int entities; // the number of busters and ghosts visible to you
-        cin >> entities; cin.ignore();
+        if (!m_in.readInt(entities))
+            return false;
         for (int i = 0; i < entities; i++) {
-            int entityId; // buster id or ghost id
-            int x;
-            int y; // position of this buster / ghost
-            int entityType; // the team id if it is a buster, -1 if it is a ghost.
-            int state; // For busters: 0=idle, 1=carrying a ghost.
-            int value; // For busters: Ghost id being carried. For ghosts: number of busters attempting to trap this ghost.
-            cin >> entityId >> x >> y >> entityType >> state >> value; cin.ignore();
+            int entityId = m_in.readInt(); // buster id or ghost id
+            int x = m_in.readInt();
+            int y = m_in.readInt(); // position of this buster / ghost
+            int entityType = m_in.readInt(); // the team id if it is a buster, -1 if it is a ghost.
+            int state = m_in.readInt(); // For busters: 0=idle, 1=carrying a ghost.
+            int value = m_in.readInt(); // For busters: Ghost id being carried. For ghosts: number of busters attempting to trap this ghost.
             updateEntity(entityId, x, y, entityType, state, value);
         }
+        m_ghostGrid.build();
+        m_ennemyGrid.build();
+        m_tracker.update(m_turn);
+        m_fog.beginTurn();
+        for (int id : m_allyIds)
+            m_fog.see(m_busters.getX(id), m_busters.getY(id));
+        m_fog.endTurn(m_ghostGrid.xs(), m_ghostGrid.ys(), m_ghostGrid.size());
+        return true;
     }
 private:
     void updateEntity(int entityId, int x, int y, int entityType, int state, int value) {
         if (entityType == -1) {
-             auto it = m_ghosts.find(entityId);
-             if (it == m_ghosts.end())
-                m_ghosts.insert(std::make_pair(entityId, Ghost(entityId, x, y)));
-            else
-                it->second = Ghost(entityId, x, y);
-            m_currentGhosts.insert(Ghost(entityId, x, y));
-            std::cerr << "[kb] see Ghost #" << entityId << " " << x << " " << y << std::endl;
+            m_ghosts.update(entityId, x, y, state, value, m_turn);
+            m_ghostGrid.insert(entityId, x, y);
+            LOG_DEBUG("[kb] see Ghost #{} {} {}", entityId, x, y);
         }
         else if (entityType == m_myTeamId) {
-             auto it = m_busters0.find(entityId);
-             if (it == m_busters0.end())
-                m_busters0.insert(std::make_pair(entityId, Buster(entityId, x, y, static_cast<Buster::State::Type>(state))));
-            else
-                it->second = Buster(entityId, x, y, static_cast<Buster::State::Type>(state));
-            std::cerr << "[kb] my Buster Ally #" << entityId << " " << x << " " << y << " " << state << std::endl;
+            if (!m_busters.isKnown(entityId))
+                m_allyIds.push_back(entityId);
+            m_busters.update(entityId, x, y, state, value, m_turn);
+            LOG_DEBUG("[kb] my Buster Ally #{} {} {} {}", entityId, x, y, state);
         }
         else {
-             auto it = m_busters1.find(entityId);
-             if (it == m_busters1.end())
-                m_busters1.insert(std::make_pair(entityId, Buster(entityId, x, y, static_cast<Buster::State::Type>(state))));
-            else
-                it->second = Buster(entityId, x, y, static_cast<Buster::State::Type>(state));
-            m_currentEnnemies.insert(Buster(entityId, x, y, static_cast<Buster::State::Type>(state)));
-            std::cerr << "[kb] see Buster Ennemy #" << entityId << " " << x << " " << y << " " << state << std::endl;
+            m_busters.update(entityId, x, y, state, value, m_turn);
+            m_tracker.see(entityId, x, y, state, m_turn);
+            m_ennemyGrid.insert(entityId, x, y);
+            LOG_DEBUG("[kb] see Buster Ennemy #{} {} {} {}", entityId, x, y, state);
         }
     }
 };
 
+// One line per buster, the whole turn is sent by flush().
 struct ActionProcessor {
-    static void move(int x, int y) { std::cout << "MOVE " << x  << " " << y << " on the move "/* << x << " " << y */<< std::endl; }
-    static void bust(int id) { std::cout << "BUST " << id << " BUST U!" << std::endl; }
-    static void stun(int id) { std::cout << "STUN " << id << " STUN U!" << std::endl; }
-    static void release() { std::cout << "RELEASE" << " Releasing!" << std::endl; }
+    io::Writer& m_out;
+    explicit ActionProcessor(io::Writer& out) : m_out(out) {}
+
+    void move(int x, int y) { m_out << "MOVE " << x  << ' ' << y << " on the move "/* << x << " " << y */<< '\n'; }
+    void bust(int id) { m_out << "BUST " << id << " BUST U!" << '\n'; }
+    void stun(int id) { m_out << "STUN " << id << " STUN U!" << '\n'; }
+    void release() { m_out << "RELEASE" << " Releasing!" << '\n'; }
+    void flush() { m_out.flush(); }
 };
 
 struct NavigationEngine {
     const KnowledgeBase& m_kb;
     explicit NavigationEngine(const KnowledgeBase& kb) : m_kb(kb) {}
     
+    // Radii are compared squared: sqrt(d2) < r <=> d2 < r * r on integers.
     // Attack
-    static bool isInStunableRadius(double distance) {
-        return distance < STUN_RADIUS;
+    static bool isInStunableRadius(int distance2) {
+        return distance2 < STUN_RADIUS * STUN_RADIUS;
     }
     // Capture
-    static bool isInBustableRadius(double distance) {
-        return distance >= BUST_MIN_RADIUS && distance < BUST_MAX_RADIUS;
+    static bool isInBustableRadius(int distance2) {
+        return distance2 >= BUST_MIN_RADIUS * BUST_MIN_RADIUS && distance2 < BUST_MAX_RADIUS * BUST_MAX_RADIUS;
     }
     static bool isBustable(int busterX, int busterY, int ghostX, int ghostY) {
-        return isInBustableRadius(distance(Point(busterX, busterY), Point(ghostX, ghostY)));
+        return isInBustableRadius(distance2(Point(busterX, busterY), Point(ghostX, ghostY)));
     };
     bool isInLineOfSight(std::size_t busterId, const Point& target)  const {
         return false;
@@ -221,11 +592,33 @@ struct NavigationEngine {
                 0 == std::abs(buster.y - target.y));    
     }
     static double distance(const Point& a, const Point& b) {
-        const int h = std::abs(a.x - b.x);
-        const int w = std::abs(a.y - b.y);
-        return std::sqrt(h * h + w * w);  
+        return std::sqrt(distance2(a, b));
+    }
+    // Fits in an int: 16000^2 + 9000^2 < 2^31.
+    static int distance2(const Point& a, const Point& b) {
+        const int h = a.x - b.x;
+        const int w = a.y - b.y;
+        return h * h + w * w;
+    }
+    // out[i] = squared distance from (x, y) to (xs[i], ys[i]) for i in [0, n).
+    static void distance2Batch(int x, int y, const int* xs, const int* ys, int n, int* out) {
+        int i = 0;
+#ifdef CB_AVX2
+        const __m256i vx = _mm256_set1_epi32(x);
+        const __m256i vy = _mm256_set1_epi32(y);
+        for (; i + 8 <= n; i += 8) {
+            __m256i dx = _mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(xs + i)), vx);
+            __m256i dy = _mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ys + i)), vy);
+            __m256i d2 = _mm256_add_epi32(_mm256_mullo_epi32(dx, dx), _mm256_mullo_epi32(dy, dy));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), d2);
+        }
+#endif
+        for (; i < n; ++i) {
+            const int dx = xs[i] - x;
+            const int dy = ys[i] - y;
+            out[i] = dx * dx + dy * dy;
+        }
     }
-    
 };
 
 struct DecisionEngine {
@@ -253,35 +646,77 @@ struct DecisionEngine {
         int timeToLoad;
     };
 
+    // Where a free buster should head this turn, decided for all busters at once.
+    struct Target {
+        enum Type {
+            None,
+            Ghost,
+            Ennemy,
+            Explore
+        };
+        Target() : type(None), id(-1) {}
+        Target(Type type, int id, const Point& point) : type(type), id(id), point(point) {}
+        Type type;
+        int id;
+        Point point;
+    };
+    static const int TURN_COST = 10;
+    static const int GHOST_BONUS = 100;
+    static const int CARRIER_BONUS = 150;
+    static const int EXPLORE_BONUS = 50; // for a cell where a ghost was just seen
+    static const int FORBIDDEN_COST = 1000000;
+    static const int BUST_RING_DISTANCE = 1200; // well inside [BUST_MIN_RADIUS, BUST_MAX_RADIUS)
+
     const KnowledgeBase& m_kb;
     NavigationEngine m_nav;
+    ActionProcessor m_action;
     std::size_t stepCount;
     std::vector<State> m_busters0State;
-    bool m_assignedKeyPoints[NB_KEYPOINTS];
+    // assignment stage: rows are the free busters, columns the ghosts,
+    // the tracked ennemies carrying a ghost, then one exploration point per row
+    Assignment m_assignment;
+    std::vector<Target> m_targets; // one per entry of m_busters0State
+    std::vector<int> m_rows;
+    std::vector<Target> m_columns;
+    std::vector<int> m_costs;
+    std::vector<int> m_rowToCol;
+    // positions of this turn, one per entry of m_busters0State
+    std::vector<int> m_bustersXs;
+    std::vector<int> m_bustersYs;
+    // squared distances from one buster to a run of grid entries
+    std::vector<int> m_distances2;
+    // first turn each buster can stun each carrier of the tracker (-1: never),
+    // one row per entry of m_busters0State
+    std::vector<int> m_interceptTurns;
+    int m_interceptDistances2[EnnemyTracker::HORIZON];
 
-    explicit DecisionEngine(const KnowledgeBase& kb)
+    DecisionEngine(const KnowledgeBase& kb, io::Writer& out)
       : m_kb(kb)
       , m_nav(kb)
+      , m_action(out)
       , stepCount(0)
     {
-        std::cerr << "[dec][initialize] size " << m_kb.m_bustersPerPlayer << std::endl; 
-        std::fill(begin(m_assignedKeyPoints), end(m_assignedKeyPoints), false);
+        LOG_INFO("[dec][initialize] size {}", m_kb.m_bustersPerPlayer);
         m_busters0State.reserve(m_kb.m_bustersPerPlayer);
-        for (auto b = m_kb.m_busters0.begin(); b != m_kb.m_busters0.end(); ++b) {
-            m_busters0State.push_back(State(b->second.id, State::Move, -1, chooseNextMovePoint(b->second)));
-        }
+        for (int id : m_kb.m_allyIds)
+            m_busters0State.push_back(State(id, State::Move));
         std::sort(
             m_busters0State.begin(),
             m_busters0State.end(),
             [](const State& a, const State& b) { return a.id < b.id; });
+        for (auto& s : m_busters0State)
+            s.targetPoint = chooseNextMovePoint(m_kb.getBuster(s.id), s);
     }
 
     void step() { 
-        std::cerr << "[dec] ===============" << std::endl; 
+        LOG_DEBUG("[dec] ===============");
         ++stepCount;
+        computePositions();
+        computeIntercepts();
+        assignTargets();
         for (auto b = m_busters0State.begin(); b != m_busters0State.end(); ++b) {
-            std::cerr << "[dec][#" << b->id << "] process " << b->type << std::endl; 
-            const Buster& buster = m_kb.m_busters0.find(b->id)->second;
+            LOG_DEBUG("[dec][#{}] process {}", b->id, b->type);
+            const Buster buster = m_kb.getBuster(b->id);
             if (b->timeToLoad != 0)
                 --(b->timeToLoad);
             switch (b->type) {    
@@ -299,25 +734,26 @@ struct DecisionEngine {
                     break;
                 default:
                 {
-                    std::cerr << "[dec][#" << b->id << "]" << " is default" << std::endl; 
+                    LOG_WARNING("[dec][#{}] is default", b->id);
                     break;
                 }    
             }          
         }
     }
+    // Sends the orders decided by step().
+    void flush() { m_action.flush(); }
     void onDeliver(const Buster& buster, State& s) {
         if (buster.state == Buster::State::Carry) {
             Point a(buster.x, buster.y);
-            if (m_nav.distance(a, s.targetPoint) <= DELIVERY_RADIUS) {
-                ActionProcessor::release();
-                std::cerr << "[dec][#" << s.id << "] release" << std::endl; 
+            if (m_nav.distance2(a, s.targetPoint) <= DELIVERY_RADIUS * DELIVERY_RADIUS) {
+                m_action.release();
+                LOG_INFO("[dec][#{}] release", s.id);
             } else {
-                std::cerr << "[dec][#" << s.id << "] going home" << std::endl; 
-                ActionProcessor::move(s.targetPoint.x, s.targetPoint.y);
+                LOG_INFO("[dec][#{}] going home", s.id);
+                m_action.move(s.targetPoint.x, s.targetPoint.y);
             }
         }
         else {
-            s.targetPoint.id = std::rand() % NB_KEYPOINTS;
             moveToNextPoint(buster, s);
         }
     }
@@ -328,16 +764,12 @@ struct DecisionEngine {
                 s.targetPoint = g_home0;
             else
                 s.targetPoint = g_home1;
-            ActionProcessor::move(s.targetPoint.x, s.targetPoint.y);
+            m_action.move(s.targetPoint.x, s.targetPoint.y);
         }
         else if (buster.state == Buster::State::Busting) {
-            auto it = std::find_if(
-                        m_kb.m_currentGhosts.begin(),
-                        m_kb.m_currentGhosts.end(),
-                        [&](const Ghost& g) { return g.id == s.targetId; } );
-            if (it != m_kb.m_currentGhosts.end()/*canHum()*/) {
-                ActionProcessor::bust(s.targetId);
-                std::cerr << "[dec][#" << s.id << "] bust #" << s.targetId << std::endl; 
+            if (m_kb.m_ghosts.isVisible(s.targetId)/*canHum()*/) {
+                m_action.bust(s.targetId);
+                LOG_INFO("[dec][#{}] bust #{}", s.id, s.targetId);
             }  else {
                 moveToNextPoint(buster, s);
             }
@@ -351,10 +783,10 @@ struct DecisionEngine {
         onMove(buster, s);
     }
     void onMove(const Buster& buster, State& s) {
-        std::cerr << "[dec][#" << s.id << "] pouet" << buster.id << " " <<  m_busters0State.begin()->id << std::endl;
-        if (stepCount > 280 && buster.id == m_busters0State.begin()->id) {
-            move(buster, s, m_kb.m_myTeamId ? g_camp_home0 : g_camp_home1);
-            std::cerr << "[dec][#" << s.id << "] camp" << std::endl;
+        LOG_DEBUG("[dec][#{}] pouet{} {}", s.id, buster.id, m_busters0State.begin()->id);
+        if (isCamping(s)) {
+            move(s, m_kb.m_myTeamId ? g_camp_home0 : g_camp_home1);
+            LOG_INFO("[dec][#{}] camp", s.id);
             return;
         }
         // if ghost reachable -> hunt
@@ -362,104 +794,263 @@ struct DecisionEngine {
         if (-1 != entityId) {
             s.type = State::Bust; 
             s.targetId = entityId;
-            ActionProcessor::bust(entityId);
-            std::cerr << "[dec][#" << s.id << "] bust #" << entityId << std::endl; 
+            m_action.bust(entityId);
+            LOG_INFO("[dec][#{}] bust #{}", s.id, entityId);
             return;
         }
         // We can stun
         entityId = canStun(buster, s);
         if (-1 != entityId) {
             s.type = State::Stun; 
-            ActionProcessor::stun(entityId);
-            std::cerr << "[dec][#" << s.id << "] stun #" << entityId << std::endl; 
+            m_action.stun(entityId);
+            LOG_INFO("[dec][#{}] stun #{}", s.id, entityId);
+            return;
+        }
+        // else go where the assignment sent us
+        const Target& target = m_targets[rowOf(s)];
+        if (target.type != Target::None) {
+            move(s, target.point);
             return;
         }
-        // else move to target
         if (! m_nav.hasReachTarget(buster, s.targetPoint)) { 
             s.type = State::Move; 
-            ActionProcessor::move(s.targetPoint.x, s.targetPoint.y);
-            std::cerr << "[dec][#" << s.id << "] still moving" << std::endl; 
+            m_action.move(s.targetPoint.x, s.targetPoint.y);
+            LOG_INFO("[dec][#{}] still moving", s.id);
             return;
         } 
         moveToNextPoint(buster, s);
         return;
     }
     void moveToNextPoint(const Buster& buster, State& s) {
-        std::size_t idx = s.targetPoint.id;
-
-        m_assignedKeyPoints[idx] = false;
-        move(buster, s, chooseNextMovePoint(buster, idx));
+        move(s, chooseNextMovePoint(buster, s));
     }
-    void move(const Buster& buster, State& s, const Point& point) {
+    void move(State& s, const Point& point) {
         s.targetPoint = point;
         s.type = State::Move;
-        std::cerr << "[dec][#" << s.id << "] move to next keyoint" << std::endl; 
+        LOG_INFO("[dec][#{}] move to next keyoint", s.id);
         
-        ActionProcessor::move(s.targetPoint.x, s.targetPoint.y);
+        m_action.move(s.targetPoint.x, s.targetPoint.y);
+    }
+    void computePositions() {
+        const std::size_t nbBusters = m_busters0State.size();
+        m_bustersXs.resize(nbBusters);
+        m_bustersYs.resize(nbBusters);
+        for (std::size_t i = 0; i < nbBusters; ++i) {
+            const Buster buster = m_kb.getBuster(m_busters0State[i].id);
+            m_bustersXs[i] = buster.x;
+            m_bustersYs[i] = buster.y;
+        }
+        // distances are computed on demand, only for the grid cells a buster queries
+        m_distances2.resize(std::max(m_kb.m_ghostGrid.size(), m_kb.m_ennemyGrid.size()));
+    }
+    // Batched over all our busters and all tracked carriers: distances to the
+    // whole extrapolated path in one kernel call, then the first turn where
+    // the carrier is within our reach plus stun range, once the stun is loaded
+    // and before the carrier can release.
+    void computeIntercepts() {
+        const EnnemyTracker& tracker = m_kb.m_tracker;
+        const int nbCarriers = tracker.getNbCarriers();
+        m_interceptTurns.assign(m_busters0State.size() * nbCarriers, -1);
+        for (std::size_t r = 0; r < m_busters0State.size(); ++r) {
+            for (int k = 0; k < nbCarriers; ++k) {
+                NavigationEngine::distance2Batch(m_bustersXs[r], m_bustersYs[r],
+                    tracker.pathXs(k), tracker.pathYs(k), EnnemyTracker::HORIZON, m_interceptDistances2);
+                for (int t = m_busters0State[r].timeToLoad; t <= tracker.getArrival(k); ++t) {
+                    // after t moves a carrier can be stunned from STUN_RADIUS + t moves away
+                    if (m_interceptDistances2[t] <= g_stunReach.limits[t]) {
+                        m_interceptTurns[r * nbCarriers + k] = t;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    std::size_t rowOf(const State& s) const { return &s - m_busters0State.data(); }
+    bool isCamping(const State& s) const { return stepCount > 280 && s.id == m_busters0State.begin()->id; }
+    // Solves busters x {ghosts, carriers, exploration points} once for the
+    // turn so that two busters never chase the same thing.
+    void assignTargets() {
+        const UniformGrid& ghosts = m_kb.m_ghostGrid;
+        m_targets.assign(m_busters0State.size(), Target());
+        m_rows.clear();
+        for (std::size_t i = 0; i < m_busters0State.size(); ++i) {
+            const State& s = m_busters0State[i];
+            if ((s.type == State::Move || s.type == State::Stun) && !isCamping(s))
+                m_rows.push_back(static_cast<int>(i));
+        }
+        if (m_rows.empty())
+            return;
+        m_columns.clear();
+        for (int g = 0; g < ghosts.size(); ++g)
+            m_columns.push_back(Target(Target::Ghost, ghosts.ids()[g], Point(ghosts.xs()[g], ghosts.ys()[g])));
+        const int nbGhostColumns = static_cast<int>(m_columns.size());
+        const EnnemyTracker& tracker = m_kb.m_tracker;
+        const int nbCarriers = tracker.getNbCarriers();
+        for (int k = 0; k < nbCarriers; ++k)
+            m_columns.push_back(Target(Target::Ennemy, k, Point()));
+        const int nbChaseColumns = static_cast<int>(m_columns.size());
+        std::uint64_t taken[FogMap::NB_WORDS] = {};
+        for (int r : m_rows) {
+            Point p = m_kb.m_fog.bestTarget(m_bustersXs[r], m_bustersYs[r], taken);
+            taken[p.id >> 6] |= std::uint64_t(1) << (p.id & 63);
+            m_columns.push_back(Target(Target::Explore, p.id, p));
+        }
+
+        const int nbRows = static_cast<int>(m_rows.size());
+        const int nbCols = static_cast<int>(m_columns.size());
+        m_costs.resize(nbRows * nbCols);
+        for (int i = 0; i < nbRows; ++i) {
+            const int r = m_rows[i];
+            int* costs = &m_costs[i * nbCols];
+            NavigationEngine::distance2Batch(m_bustersXs[r], m_bustersYs[r], ghosts.xs(), ghosts.ys(), ghosts.size(), m_distances2.data());
+            for (int c = 0; c < nbGhostColumns; ++c) {
+                const int d2 = m_distances2[c];
+                // too close to bust: the moves to step out of BUST_MIN_RADIUS first
+                const int turns = d2 < BUST_MIN_RADIUS * BUST_MIN_RADIUS
+                    ? (BUST_MIN_RADIUS - isqrt(d2) + MOVE_PER_TURN - 1) / MOVE_PER_TURN : g_bustReach.turns(d2);
+                costs[c] = TURN_COST * turns - GHOST_BONUS;
+            }
+            for (int c = nbGhostColumns; c < nbChaseColumns; ++c) {
+                // no intercept before the release with a loaded stun: no point chasing
+                const int turns = m_interceptTurns[r * nbCarriers + m_columns[c].id];
+                costs[c] = turns < 0 ? FORBIDDEN_COST : TURN_COST * turns - CARRIER_BONUS;
+            }
+            for (int c = nbChaseColumns; c < nbCols; ++c) {
+                const Point& p = m_columns[c].point;
+                const int turns = g_exploreReach.turns(NavigationEngine::distance2(Point(m_bustersXs[r], m_bustersYs[r]), p));
+                costs[c] = TURN_COST * turns - static_cast<int>(EXPLORE_BONUS * m_kb.m_fog.getBelief(p.id));
+            }
+        }
+        m_rowToCol.resize(nbRows);
+        m_assignment.solve(m_costs.data(), nbRows, nbCols, m_rowToCol.data());
+        for (int i = 0; i < nbRows; ++i) {
+            Target& target = m_targets[m_rows[i]];
+            target = m_columns[m_rowToCol[i]];
+            if (target.type == Target::Ennemy) {
+                // head for where the carrier will be when we can stun it
+                const int k = target.id;
+                const int turns = std::max(0, m_interceptTurns[m_rows[i] * nbCarriers + k]);
+                target.id = tracker.getId(k);
+                target.point = tracker.getPosition(k, turns);
+            }
+            else if (target.type == Target::Ghost)
+                target.point = getBustingPoint(target.point, m_bustersXs[m_rows[i]], m_bustersYs[m_rows[i]]);
+            // only exploration points are remembered as claimed cells
+            if (target.type != Target::Explore)
+                target.point.id = -1;
+        }
+    }
+    // Where to bust ghost from: BUST_RING_DISTANCE away towards the buster, or
+    // towards the map center when that is off the map or the buster stands on
+    // the ghost. Heading for the ghost itself ends within BUST_MIN_RADIUS.
+    static Point getBustingPoint(const Point& ghost, int busterX, int busterY) {
+        static const Point CENTER((MAP_WIDTH - 1) / 2, (MAP_HEIGHT - 1) / 2);
+        Point point = stepFrom(ghost, busterX, busterY);
+        if (!NavigationEngine::isInBustableRadius(NavigationEngine::distance2(point, ghost)))
+            point = stepFrom(ghost, CENTER.x, CENTER.y);
+        return point;
+    }
+    // BUST_RING_DISTANCE from ghost towards (x, y), kept on the map.
+    static Point stepFrom(const Point& ghost, int x, int y) {
+        const double dx = x - ghost.x;
+        const double dy = y - ghost.y;
+        const double d = std::sqrt(dx * dx + dy * dy);
+        if (d == 0)
+            return ghost;
+        const int px = ghost.x + static_cast<int>(std::lround(dx * BUST_RING_DISTANCE / d));
+        const int py = ghost.y + static_cast<int>(std::lround(dy * BUST_RING_DISTANCE / d));
+        return Point(std::max(0, std::min(MAP_WIDTH - 1, px)), std::max(0, std::min(MAP_HEIGHT - 1, py)));
     }
     int canStun(const Buster& buster, const State& s) {
         int targetId = -1;
-        std::cerr << "[dec][#" << s.id << "] s.timeToLoad "<< s.timeToLoad << std::endl; 
+        LOG_DEBUG("[dec][#{}] s.timeToLoad {}", s.id, s.timeToLoad);
         if (0 == s.timeToLoad) {
             
-            std::cerr << "[dec][#" << s.id << "] nb ennemy "<< m_kb.m_currentEnnemies.size() << std::endl; 
-            Point a(buster.x, buster.y);
-            int minDist = std::numeric_limits<int>::max();
-            for (auto it = m_kb.m_currentEnnemies.begin(); it != m_kb.m_currentEnnemies.end(); ++it) {
-                Point b(it->x, it->y);
-                auto d = m_nav.distance(a, b);
-                if (d < minDist && m_nav.isInStunableRadius(d)) {
-                    targetId = it->id;
-                    minDist = d;
+            LOG_DEBUG("[dec][#{}] nb ennemy {}", s.id, m_kb.m_ennemyGrid.size());
+            const UniformGrid& ennemies = m_kb.m_ennemyGrid;
+            int* distances2 = m_distances2.data();
+            int minDist2 = std::numeric_limits<int>::max();
+            ennemies.forEachSpan(buster.x, buster.y, STUN_RADIUS, [&](int first, int last) {
+                NavigationEngine::distance2Batch(buster.x, buster.y, ennemies.xs() + first, ennemies.ys() + first, last - first, distances2);
+                for (int i = first; i < last; ++i) {
+                    const int d2 = distances2[i - first];
+                    if (m_nav.isInStunableRadius(d2) && isCloser(d2, ennemies.ids()[i], minDist2, targetId)) {
+                        targetId = ennemies.ids()[i];
+                        minDist2 = d2;
+                    }
                 }
-            }
+            });
         }
         return targetId;   
     }
-    int canHunt(const Buster& buster) const {
+    int canHunt(const Buster& buster) {
         int targetId = -1;
-        Point a(buster.x, buster.y);
-        int minDist = std::numeric_limits<int>::max();
-        for (auto it = m_kb.m_currentGhosts.begin(); it != m_kb.m_currentGhosts.end(); ++it) {
-            Point b(it->x, it->y);
-            auto d = m_nav.distance(a, b);
-            if (d < minDist && m_nav.isInBustableRadius(d)) {
-                targetId = it->id;
-                minDist = d;
+        const UniformGrid& ghosts = m_kb.m_ghostGrid;
+        int* distances2 = m_distances2.data();
+        int minDist2 = std::numeric_limits<int>::max();
+        ghosts.forEachSpan(buster.x, buster.y, BUST_MAX_RADIUS, [&](int first, int last) {
+            NavigationEngine::distance2Batch(buster.x, buster.y, ghosts.xs() + first, ghosts.ys() + first, last - first, distances2);
+            for (int i = first; i < last; ++i) {
+                const int d2 = distances2[i - first];
+                if (m_nav.isInBustableRadius(d2) && isCloser(d2, ghosts.ids()[i], minDist2, targetId)) {
+                    targetId = ghosts.ids()[i];
+                    minDist2 = d2;
+                }
             }
-        }
+        });
         return targetId;        
     }
-    Point chooseNextMovePoint(const Buster& b, std::size_t current = NB_KEYPOINTS) {
-        std::size_t idx = current;
-        if (idx == NB_KEYPOINTS) {
-            idx = 4 * (std::rand() % 4);
-        }
-        else {
-            idx = (idx + 1) % NB_KEYPOINTS;
+    // Grid order is not id order: ties go to the smallest id as with the former id sorted scan.
+    static bool isCloser(int d, int id, int minDist, int minId) {
+        return d < minDist || (d == minDist && id < minId);
+    }
+    // Most promising cell of the fog map that no other buster is already heading to.
+    Point chooseNextMovePoint(const Buster& b, const State& s) const {
+        std::uint64_t taken[FogMap::NB_WORDS] = {};
+        for (auto& other : m_busters0State) {
+            if (other.id != s.id && other.type == State::Move && other.targetPoint.id >= 0)
+                taken[other.targetPoint.id >> 6] |= std::uint64_t(1) << (other.targetPoint.id & 63);
         }
-//        while (m_assignedKeyPoints[idx])
-//            idx = (idx + 1) % NB_KEYPOINTS;
-        m_assignedKeyPoints[idx] = true;
-        return g_keypoints[idx];
+        return m_kb.m_fog.bestTarget(b.x, b.y, taken);
     }
 };
 
+#ifndef CB_NO_MAIN
 /**
  * Send your busters out into the fog to trap ghosts and bring them home!
  **/
 int main()
 {
-    std::srand(std::time(0));
-    
-    KnowledgeBase kb;
+    static io::Reader in;
+    static io::Writer out;
+    static TurnProfiler profiler;
+    capture::startFromEnv(in, "code_buster");
+    in.eof(); // waits for the referee
+    profiler.beginTurn();
+    KnowledgeBase kb(in);
     kb.step();
-    DecisionEngine dec(kb);
+    profiler.mark(TurnProfiler::Parse);
+    DecisionEngine dec(kb, out);
     dec.step();
+    profiler.mark(TurnProfiler::Decide);
+    dec.flush();
+    profiler.mark(TurnProfiler::Emit);
+    profiler.endTurn();
+    logging::trace().flush();
    
     // game loop
-    while (1) {
-        kb.step();
+    while (!in.eof()) {
+        profiler.beginTurn();
+        if (!kb.step())
+            break;
+        profiler.mark(TurnProfiler::Parse);
         dec.step();
+        profiler.mark(TurnProfiler::Decide);
+        dec.flush();
+        profiler.mark(TurnProfiler::Emit);
+        profiler.endTurn();
+        logging::trace().flush();
     }
-};
\ No newline at end of file
+    profiler.print(stderr);
+};
+#endif
@@ -0,0 +1,153 @@
+// Match runner for the code_buster bot on the headless engine.
+// Plays N matches of the bot against an opponent, spread over all cores
+// with one engine seed per match (so results do not depend on the number of
+// threads), the bot switching sides every match. The opponent is the bot
+// itself, the reference BaselinePlayer or any other build of a bot, run as
+// a child process speaking the arena protocol. Reports the win rate with a
+// 95% confidence interval, the ghosts captured and the throughput.
+//
+// usage: code_buster_match [--matches N] [--busters B] [--ghosts G] [--seed S]
+//                          [--threads T] [--opponent self|baseline|PATH]
+#define CB_NO_MAIN
+#include "main_one_file.cpp"
+
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "game_engine.hpp"
+#include "work_stealing_pool.hpp"
+
+namespace {
+
+// Another bot executable, fed through pipes. Every answer is one line per buster.
+struct ProcessPlayer : public IPlayer {
+    ProcessPlayer(const std::string& path, int bustersPerPlayer) : m_bustersPerPlayer(bustersPerPlayer), m_pid(-1), m_in(-1), m_out(nullptr) {
+        int toChild[2], fromChild[2];
+        // close on exec: children spawned by other threads must not hold our pipes
+        if (::pipe2(toChild, O_CLOEXEC) != 0 || ::pipe2(fromChild, O_CLOEXEC) != 0)
+            return;
+        m_pid = ::fork();
+        if (m_pid == 0) {
+            const int devNull = ::open("/dev/null", O_WRONLY);
+            ::dup2(toChild[0], 0);
+            ::dup2(fromChild[1], 1);
+            ::dup2(devNull, 2); // its logs
+            ::execl(path.c_str(), path.c_str(), static_cast<char*>(nullptr));
+            ::_exit(127);
+        }
+        ::close(toChild[0]);
+        ::close(fromChild[1]);
+        m_in = toChild[1];
+        m_out = ::fdopen(fromChild[0], "r");
+    }
+    ~ProcessPlayer() {
+        if (m_in >= 0)
+            ::close(m_in);
+        if (m_out != nullptr)
+            std::fclose(m_out);
+        if (m_pid > 0)
+            ::waitpid(m_pid, nullptr, 0);
+    }
+    virtual const std::string& play(const std::string& input) override {
+        m_output.clear();
+        if (m_in < 0 || m_out == nullptr || ::write(m_in, input.data(), input.size()) != static_cast<ssize_t>(input.size()))
+            return m_output;
+        char line[256];
+        for (int i = 0; i < m_bustersPerPlayer && std::fgets(line, sizeof(line), m_out) != nullptr; ++i)
+            m_output += line;
+        return m_output;
+    }
+
+    int m_bustersPerPlayer;
+    pid_t m_pid;
+    int m_in;
+    std::FILE* m_out;
+    std::string m_output;
+};
+
+struct Result {
+    int outcome; // 1 win, 0 draw, -1 loss for the bot
+    int score;
+    int opponentScore;
+    int nbTurns;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int nbMatches = 1000;
+    int nbBusters = 3;
+    int nbGhosts = 15;
+    std::uint32_t seed = 1;
+    unsigned nbThreads = std::thread::hardware_concurrency();
+    std::string opponent = "self";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--matches")
+            nbMatches = std::max(1, std::atoi(argv[i + 1]));
+        else if (arg == "--busters")
+            nbBusters = std::max(2, std::min(5, std::atoi(argv[i + 1])));
+        else if (arg == "--ghosts")
+            nbGhosts = std::max(8, std::min(28, std::atoi(argv[i + 1])));
+        else if (arg == "--seed")
+            seed = static_cast<std::uint32_t>(std::atoi(argv[i + 1]));
+        else if (arg == "--threads")
+            nbThreads = static_cast<unsigned>(std::max(1, std::atoi(argv[i + 1])));
+        else if (arg == "--opponent")
+            opponent = argv[i + 1];
+    }
+    // a child bot that died must not kill the runner
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::vector<Result> results(nbMatches);
+    WorkStealingPool pool(nbThreads);
+    auto start = std::chrono::steady_clock::now();
+    pool.parallelFor(nbMatches, [&](unsigned, std::size_t m) {
+        // the bot logs every decision on stderr, the trace is per thread
+        logging::trace().setOutput(-1);
+        GameEngine engine(nbBusters, nbGhosts, seed + static_cast<std::uint32_t>(m));
+        BotPlayer bot;
+        std::unique_ptr<IPlayer> other;
+        if (opponent == "self")
+            other.reset(new BotPlayer());
+        else if (opponent == "baseline")
+            other.reset(new BaselinePlayer());
+        else
+            other.reset(new ProcessPlayer(opponent, nbBusters));
+        const int team = static_cast<int>(m % 2);
+        const int winner = team == 0 ? playMatch(engine, bot, *other) : playMatch(engine, *other, bot);
+        Result& r = results[m];
+        r.outcome = winner == -1 ? 0 : winner == team ? 1 : -1;
+        r.score = engine.getScore(team);
+        r.opponentScore = engine.getScore(1 - team);
+        r.nbTurns = engine.getTurn();
+    });
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int nbWins = 0, nbDraws = 0;
+    long long score = 0, opponentScore = 0, nbTurns = 0;
+    for (const Result& r : results) {
+        nbWins += r.outcome == 1;
+        nbDraws += r.outcome == 0;
+        score += r.score;
+        opponentScore += r.opponentScore;
+        nbTurns += r.nbTurns;
+    }
+    // a draw counts half a win; normal approximation of the interval
+    const double rate = (nbWins + 0.5 * nbDraws) / nbMatches;
+    const double margin = 1.96 * std::sqrt(rate * (1 - rate) / nbMatches);
+    std::printf("opponent %s  matches %d  threads %u\n", opponent.c_str(), nbMatches, pool.size());
+    std::printf("wins %d  draws %d  losses %d  win rate %.1f%% +- %.1f%%\n", nbWins, nbDraws, nbMatches - nbWins - nbDraws,
+        100 * rate, 100 * margin);
+    std::printf("ghosts captured %.2f vs %.2f  mean turns %.1f\n", double(score) / nbMatches, double(opponentScore) / nbMatches,
+        double(nbTurns) / nbMatches);
+    std::printf("%.1f matches/s\n", nbMatches / seconds);
+    return 0;
+}
@@ -0,0 +1,41 @@
+// Replays a capture log (CG_CAPTURE=file ./code_buster) through
+// KnowledgeBase and DecisionEngine, turn by turn as main() does, see
+// replay.hpp; the phase profile of the bot follows.
+//
+// usage: code_buster_replay LOG [--golden FILE] [--update-golden] [--turns]
+#define CB_NO_MAIN
+#include "main_one_file.cpp"
+
+#include <memory>
+
+#include "replay.hpp"
+
+int main(int argc, char** argv) {
+    Replay replay(argc, argv, "code_buster");
+    if (!replay.isValid())
+        return 2;
+    io::Reader& in = replay.getInput();
+    TurnProfiler profiler;
+    std::unique_ptr<KnowledgeBase> kb;
+    std::unique_ptr<DecisionEngine> dec;
+    const int status = replay.run([&]() {
+        if (in.eof())
+            return false;
+        profiler.beginTurn();
+        if (!kb)
+            kb.reset(new KnowledgeBase(in));
+        if (!kb->step())
+            return false;
+        profiler.mark(TurnProfiler::Parse);
+        if (!dec)
+            dec.reset(new DecisionEngine(*kb, replay.getOutput()));
+        dec->step();
+        profiler.mark(TurnProfiler::Decide);
+        dec->flush();
+        profiler.mark(TurnProfiler::Emit);
+        profiler.endTurn();
+        return true;
+    });
+    profiler.print(stdout);
+    return status;
+}
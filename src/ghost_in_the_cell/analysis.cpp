@@ -0,0 +1,196 @@
+// Offline evaluation of BestProdStrategy alternatives on many positions.
+// For every position the plan of BestProdStrategy, WAIT, the greedy model
+// and mutations of the BestProd plan are each scored by noisy rollouts;
+// the rollouts of a position are spread over a work-stealing pool where
+// every worker owns its RolloutEvaluator (root state copy + RNG).
+//
+// usage: ghost_in_the_cell_analysis [--threads 1,8,32] [--positions N] [--factories N]
+//                                   [--candidates N] [--rollouts N] [--seed S] [game logs...]
+// Game logs are raw referee inputs (init block then turns); without any,
+// synthetic positions are generated.
+#define GITC_NO_MAIN
+#include "main_one_file.cpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include "map_generator.hpp"
+#include "work_stealing_pool.hpp"
+
+namespace {
+
+struct Options {
+   Options() : nbPositions(200), nbFactories(NB_FACTORY_MAX), nbCandidates(16), nbRollouts(32), seed(42) {}
+   std::vector<unsigned> threads;
+   int nbPositions;
+   int nbFactories;
+   int nbCandidates;
+   int nbRollouts;
+   std::uint32_t seed;
+   std::vector<std::string> logs;
+};
+
+struct Analysis {
+   Analysis(const Knowledge& kb, Action& action, WorkStealingPool& pool, const Options& options)
+      : m_kb(kb), m_action(action), m_pool(pool), m_options(options), m_arena(TURN_ARENA_SIZE)
+      , m_stride((options.nbCandidates + 7) & ~7) // one cache line per worker row
+      , m_sums(pool.size() * m_stride), m_plans(options.nbCandidates)
+      , m_nbPositions(0), m_nbEvaluations(0), m_nbBestProdWins(0)
+   {
+      m_evaluators.reserve(pool.size());
+      for (unsigned w = 0; w < pool.size(); ++w)
+         m_evaluators.emplace_back(kb, options.seed + 7919 * (w + 1));
+   }
+   // Scores the alternatives of the current turn of the knowledge.
+   void operator()() {
+      RolloutEvaluator& main = m_evaluators[0];
+      main.load();
+      for (unsigned w = 1; w < m_evaluators.size(); ++w)
+         m_evaluators[w].load(main.getRoot());
+
+      const int nbCandidates = m_options.nbCandidates;
+      const int nbRollouts = m_options.nbRollouts;
+      m_plans[0] = Plan();
+      if (nbCandidates > 1)
+         main.greedyPlan(m_plans[1]);
+      if (nbCandidates > 2) {
+         m_arena.reset();
+         BestProdStrategy strategy(m_kb, m_action, m_arena);
+         strategy();
+         m_plans[2] = Plan();
+         for (int i = 0; i < m_action.getNbOrders(); ++i)
+            m_plans[2].push(m_action.getOrder(i));
+         m_action.terminate();
+      }
+      for (int c = 3; c < nbCandidates; ++c)
+         main.mutate(m_plans[2], m_plans[c]);
+
+      std::fill(m_sums.begin(), m_sums.end(), 0);
+      m_pool.parallelFor(static_cast<std::size_t>(nbCandidates) * nbRollouts, [&](unsigned workerId, std::size_t task) {
+         auto c = task / nbRollouts;
+         m_sums[workerId * m_stride + c] += m_evaluators[workerId].evaluate(m_plans[c], true);
+      });
+      int best = 0;
+      long long bestSum = std::numeric_limits<long long>::min();
+      for (int c = 0; c < nbCandidates; ++c) {
+         long long sum = 0;
+         for (unsigned w = 0; w < m_pool.size(); ++w)
+            sum += m_sums[w * m_stride + c];
+         if (sum > bestSum) {
+            bestSum = sum;
+            best = c;
+         }
+      }
+      ++m_nbPositions;
+      m_nbEvaluations += static_cast<long long>(nbCandidates) * nbRollouts;
+      if (best == 2)
+         ++m_nbBestProdWins;
+   }
+
+   const Knowledge& m_kb;
+   Action& m_action;
+   WorkStealingPool& m_pool;
+   const Options& m_options;
+   Arena m_arena;
+   std::size_t m_stride;
+   std::vector<long long> m_sums;
+   std::vector<Plan> m_plans;
+   std::vector<RolloutEvaluator> m_evaluators;
+   int m_nbPositions;
+   long long m_nbEvaluations;
+   int m_nbBestProdWins;
+};
+
+std::vector<std::string> loadGames(const Options& options) {
+   std::vector<std::string> games;
+   for (auto& path : options.logs) {
+      std::ifstream file(path);
+      if (!file) {
+         std::fprintf(stderr, "cannot open %s\n", path.c_str());
+         std::exit(1);
+      }
+      std::stringstream content;
+      content << file.rdbuf();
+      games.push_back(content.str());
+   }
+   if (games.empty()) {
+      // one synthetic game per 10 positions, each turn being a random mid-game position
+      MapGenerator generator(options.seed);
+      for (int p = 0; p < options.nbPositions; p += 10) {
+         std::string game = generator.generateInit(options.nbFactories);
+         for (int t = p; t < std::min(options.nbPositions, p + 10); ++t)
+            game += generator.generateTurn(2 * options.nbFactories);
+         games.push_back(game);
+      }
+   }
+   return games;
+}
+
+Options parseOptions(int argc, char** argv) {
+   Options options;
+   for (int i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+      auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+      if (arg == "--threads") {
+         std::stringstream list(next());
+         std::string item;
+         while (std::getline(list, item, ','))
+            options.threads.push_back(static_cast<unsigned>(std::atoi(item.c_str())));
+      }
+      else if (arg == "--positions")
+         options.nbPositions = std::atoi(next());
+      else if (arg == "--factories")
+         options.nbFactories = std::min<int>(std::atoi(next()), NB_FACTORY_MAX);
+      else if (arg == "--candidates")
+         options.nbCandidates = std::max(3, std::atoi(next()));
+      else if (arg == "--rollouts")
+         options.nbRollouts = std::max(1, std::atoi(next()));
+      else if (arg == "--seed")
+         options.seed = static_cast<std::uint32_t>(std::atoi(next()));
+      else
+         options.logs.push_back(arg);
+   }
+   if (options.threads.empty()) {
+      options.threads.push_back(1);
+      if (std::thread::hardware_concurrency() > 1)
+         options.threads.push_back(std::thread::hardware_concurrency());
+   }
+   return options;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+   Options options = parseOptions(argc, argv);
+   std::vector<std::string> games = loadGames(options);
+   logging::trace().setOutput(-1);
+
+   double referenceRate = 0;
+   std::printf("%8s %10s %12s %12s %8s %10s\n", "threads", "positions", "evaluations", "evals/s", "speedup", "bestprod");
+   for (unsigned nbThreads : options.threads) {
+      WorkStealingPool pool(nbThreads);
+      io::Reader in(nullptr, 0);
+      std::string sink;
+      io::Writer out(&sink);
+      Knowledge kb(in);
+      Action action(out, kb);
+      Analysis analysis(kb, action, pool, options);
+
+      auto start = std::chrono::steady_clock::now();
+      for (auto& game : games) {
+         in.reset(game.data(), game.size());
+         kb.initialize();
+         while (kb.step())
+            analysis();
+      }
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      double rate = analysis.m_nbEvaluations / seconds;
+      if (referenceRate == 0)
+         referenceRate = rate;
+      std::printf("%8u %10d %12lld %12.0f %7.2fx %9.1f%%\n", pool.size(), analysis.m_nbPositions, analysis.m_nbEvaluations,
+         rate, rate / referenceRate, 100.0 * analysis.m_nbBestProdWins / std::max(1, analysis.m_nbPositions));
+   }
+   return 0;
+}
@@ -0,0 +1,217 @@
+// Micro-benchmark of the BestProdStrategy phases.
+// Synthetic mid-game positions are generated for every map size from 3 to
+// NB_FACTORY_MAX factories (then doubling, for the oversized stress build),
+// parsed by Knowledge and played once by each phase of the strategy; every
+// phase and both scoring functions are timed separately.
+// Then whole games are played by Simulation with the global operator new
+// counted: once warmed up, a turn must not allocate (exit status 2).
+// Last, SearchStrategy plays a few games: its worst turn, parsing included,
+// must stay within the time the referee allows (exit status 3).
+//
+// --factories N restricts all of this to maps of N factories.
+//
+// usage: ghost_in_the_cell_bench [--positions N] [--search-turns N] [--seed S] [--factories N]
+#define GITC_NO_MAIN
+#include "main_one_file.cpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "latency_stats.hpp"
+#include "map_generator.hpp"
+
+static std::size_t g_nbAllocations = 0; // the bench is single threaded
+
+// Every replaceable operator new / delete goes through these two; out of
+// line so that gcc does not pair an inlined malloc with a delete.
+__attribute__((noinline)) static void* countedAllocate(std::size_t size) noexcept {
+   ++g_nbAllocations;
+   return std::malloc(size == 0 ? 1 : size);
+}
+__attribute__((noinline)) static void countedFree(void* p) noexcept { std::free(p); }
+
+void* operator new(std::size_t size) {
+   if (void* p = countedAllocate(size))
+      return p;
+   throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) {
+   if (void* p = countedAllocate(size))
+      return p;
+   throw std::bad_alloc();
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return countedAllocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return countedAllocate(size); }
+void operator delete(void* p) noexcept { countedFree(p); }
+void operator delete[](void* p) noexcept { countedFree(p); }
+void operator delete(void* p, std::size_t) noexcept { countedFree(p); }
+void operator delete[](void* p, std::size_t) noexcept { countedFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { countedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { countedFree(p); }
+
+namespace {
+
+enum Phase {
+   PhaseIncrementProd,
+   PhaseBomb,
+   PhaseAttack,
+   PhaseSupport,
+   PhaseAttackScores,
+   PhaseSupportScores,
+   NB_PHASES
+};
+const char* const PHASE_NAMES[NB_PHASES] = { "INC", "BOMB", "MOVE ATTACK", "MOVE SUPPORT", "getDecisionAttackScores", "getDecisionSupportScores" };
+
+struct Bench {
+   Bench(BestProdStrategy& strategy, Action& action) : m_strategy(strategy), m_action(action), m_sink(0) {}
+
+   template<typename F>
+   void time(Phase phase, F&& f) {
+      auto start = std::chrono::steady_clock::now();
+      f();
+      m_stats[phase].record(std::chrono::steady_clock::now() - start);
+   }
+   // Plays the current turn of the knowledge phase by phase.
+   void operator()() {
+      time(PhaseIncrementProd, [&]() { m_strategy.playIncrementProd(); });
+      time(PhaseBomb, [&]() { m_strategy.playBomb(); });
+      time(PhaseAttack, [&]() { m_strategy.playAttack(); });
+      time(PhaseSupport, [&]() { m_strategy.playSupport(); });
+      time(PhaseAttackScores, [&]() { m_sink += m_strategy.getDecisionAttackScores().size(); });
+      time(PhaseSupportScores, [&]() { m_sink += m_strategy.getDecisionSupportScores().size(); });
+      m_sink += m_action.getNbOrders();
+      m_action.terminate();
+   }
+
+   BestProdStrategy& m_strategy;
+   Action& m_action;
+   LatencyStats m_stats[NB_PHASES];
+   std::size_t m_sink;
+};
+
+// Plays nbTurns random turns after nbWarmupTurns, returns the heap allocations of the former.
+std::size_t countSteadyStateAllocations(MapGenerator& generator, int nbFactories, int nbWarmupTurns, int nbTurns, std::size_t& arenaPeak) {
+   std::string game = generator.generateInit(nbFactories) + generator.generateStartTurn();
+   for (int t = 1; t < nbWarmupTurns + nbTurns; ++t)
+      game += generator.generateTurn(2 * nbFactories);
+   io::Reader in(game.data(), game.size());
+   std::string out;
+   out.reserve(io::Writer::BUFFER_SIZE); // stands for stdout, not the bot's business
+   io::Writer writer(&out);
+   Simulation sim(in, writer, Decision::BestProd);
+   std::size_t nbAllocations = 0;
+   for (int t = 0; sim.step(); ++t) {
+      if (t == nbWarmupTurns - 1)
+         nbAllocations = g_nbAllocations;
+      out.clear(); // keeps its capacity
+   }
+   arenaPeak = sim.getArena().getPeak();
+   return g_nbAllocations - nbAllocations;
+}
+
+// Plays nbTurns random turns with SearchStrategy, returns the worst turn in ns.
+std::uint64_t getWorstSearchTurn(MapGenerator& generator, int nbFactories, int nbTurns) {
+   std::string game = generator.generateInit(nbFactories) + generator.generateStartTurn();
+   for (int t = 1; t < nbTurns; ++t)
+      game += generator.generateTurn(2 * nbFactories);
+   io::Reader in(game.data(), game.size());
+   std::string out;
+   io::Writer writer(&out);
+   Simulation sim(in, writer, Decision::Search);
+   while (sim.step())
+      out.clear();
+   return sim.getProfiler().getStats(TurnProfiler::NB_PHASES).max();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+   int nbPositions = 2000;
+   int nbSearchTurns = 20;
+   std::uint32_t seed = 42;
+   int nbFactoriesOnly = 0;
+   for (int i = 1; i + 1 < argc; i += 2) {
+      std::string arg = argv[i];
+      if (arg == "--positions")
+         nbPositions = std::max(1, std::atoi(argv[i + 1]));
+      else if (arg == "--search-turns")
+         nbSearchTurns = std::max(0, std::atoi(argv[i + 1]));
+      else if (arg == "--seed")
+         seed = static_cast<std::uint32_t>(std::atoi(argv[i + 1]));
+      else if (arg == "--factories")
+         nbFactoriesOnly = std::max(0, std::atoi(argv[i + 1]));
+   }
+   if (nbFactoriesOnly > static_cast<int>(NB_FACTORY_MAX)) {
+      std::fprintf(stderr, "--factories %d: this build handles %zu factories at most\n", nbFactoriesOnly, NB_FACTORY_MAX);
+      return 1;
+   }
+   const int minFactories = nbFactoriesOnly != 0 ? nbFactoriesOnly : 3;
+   const int maxFactories = nbFactoriesOnly != 0 ? nbFactoriesOnly : static_cast<int>(NB_FACTORY_MAX);
+
+   logging::trace().setOutput(-1);
+   std::size_t sink = 0;
+   for (int nbFactories = minFactories; nbFactories <= maxFactories; nbFactories = nbFactories < 15 ? nbFactories + 2 : 2 * nbFactories + 1) {
+      // one game per 10 positions, each turn being a random mid-game position
+      MapGenerator generator(seed + nbFactories);
+      std::vector<std::string> games;
+      for (int p = 0; p < nbPositions; p += 10) {
+         std::string game = generator.generateInit(nbFactories);
+         for (int t = p; t < std::min(nbPositions, p + 10); ++t)
+            game += generator.generateTurn(2 * nbFactories);
+         games.push_back(game);
+      }
+
+      io::Reader in(nullptr, 0);
+      std::string out;
+      io::Writer writer(&out);
+      Knowledge kb(in);
+      Action action(writer, kb);
+      Arena arena(TURN_ARENA_SIZE);
+      BestProdStrategy strategy(kb, action, arena);
+      Bench bench(strategy, action);
+      for (auto& game : games) {
+         in.reset(game.data(), game.size());
+         kb.initialize();
+         while (kb.step()) {
+            arena.reset();
+            bench();
+         }
+      }
+      char title[32];
+      std::snprintf(title, sizeof(title), "%d factories", nbFactories);
+      LatencyStats::printHeader(stdout, title);
+      for (int phase = 0; phase < NB_PHASES; ++phase)
+         bench.m_stats[phase].print(stdout, PHASE_NAMES[phase]);
+      std::printf("\n");
+      sink += bench.m_sink;
+   }
+
+   const int nbWarmupTurns = 10;
+   const int nbTurns = 200;
+   std::size_t nbAllocations = 0;
+   std::printf("%-12s %8s %12s %12s\n", "allocations", "turns", "heap allocs", "arena peak");
+   for (int nbFactories = minFactories; nbFactories <= maxFactories; nbFactories = nbFactories < 15 ? nbFactories + 2 : 2 * nbFactories + 1) {
+      MapGenerator generator(seed + 1000 + nbFactories);
+      std::size_t arenaPeak;
+      const std::size_t n = countSteadyStateAllocations(generator, nbFactories, nbWarmupTurns, nbTurns, arenaPeak);
+      std::printf("%2d factories %8d %12zu %11zuB\n", nbFactories, nbTurns, n, arenaPeak);
+      nbAllocations += n;
+   }
+   std::printf("\n");
+
+   std::uint64_t worstSearchTurn = 0;
+   std::printf("%-12s %8s %12s %12s\n", "search", "turns", "worst(ms)", "budget(ms)");
+   for (int nbFactories = minFactories; nbSearchTurns > 0 && nbFactories <= maxFactories; nbFactories = 2 * nbFactories + 1) {
+      MapGenerator generator(seed + 2000 + nbFactories);
+      const std::uint64_t worst = getWorstSearchTurn(generator, nbFactories, nbSearchTurns);
+      std::printf("%2d factories %8d %12.2f %12.0f\n", nbFactories, nbSearchTurns, worst / 1e6, SEARCH_BUDGET_MS);
+      worstSearchTurn = std::max(worstSearchTurn, worst);
+   }
+
+   if (nbAllocations != 0)
+      return 2;
+   if (worstSearchTurn > TURN_TIMEOUT_MS * 1e6)
+      return 3;
+   return sink == 0 ? 1 : 0;
+}
@@ -0,0 +1,233 @@
+#ifndef GITC_GAME_ENGINE_HPP
+#define GITC_GAME_ENGINE_HPP
+
+// Headless Ghost in the Cell matches. Include after main_one_file.cpp (with
+// GITC_NO_MAIN defined): the referee is the bot's own forward model
+// (Simulator on a SimState, player 0 being Ally), maps come from
+// MapGenerator. Each player gets its referee input as text, from its own
+// point of view, and answers with the line its bot printed.
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include "map_generator.hpp"
+
+struct GameEngine {
+   static const int NB_TURNS_MAX = 200;
+
+   GameEngine(int nbFactories, std::uint32_t seed)
+      : m_in(nullptr, 0), m_kb(m_in), m_sim(m_kb), m_turn(0)
+   {
+      MapGenerator generator(seed);
+      m_init = generator.generateInit(nbFactories);
+      std::string start = m_init + generator.generateStartTurn();
+      m_in.reset(start.data(), start.size());
+      m_kb.initialize();
+      m_kb.step();
+      m_sim.load(m_state);
+   }
+
+   int getTurn() const { return m_turn; }
+   int getNbFactories() const { return m_kb.getNbFactories(); }
+   bool isOver() const { return m_turn >= NB_TURNS_MAX || m_sim.isOver(m_state); }
+   // Cyborgs of player, in its factories and on the way.
+   int getNbUnits(int player) const {
+      const Faction::Type faction = getFaction(player);
+      int units = 0;
+      for (int i = 0; i < getNbFactories(); ++i) {
+         if (m_state.m_factories[i].m_faction == faction)
+            units += m_state.m_factories[i].m_nbCyborgs;
+         units += m_state.m_troops[i].m_nbCyborgs[faction];
+      }
+      return units;
+   }
+   // Player with more cyborgs, -1 on a draw.
+   int getWinner() const {
+      const int units0 = getNbUnits(0);
+      const int units1 = getNbUnits(1);
+      return units0 == units1 ? -1 : (units0 > units1 ? 0 : 1);
+   }
+
+   // First lines a bot reads, the same for both players.
+   const std::string& getInitInput() const { return m_init; }
+   // Entities of the turn, owners as seen by player (1 itself, -1 the other one).
+   std::string getTurnInput(int player) const {
+      std::string body;
+      int id = 0;
+      for (int i = 0; i < getNbFactories(); ++i) {
+         const Factory& f = m_state.m_factories[i];
+         body += std::to_string(id++) + " FACTORY " + std::to_string(getOwner(player, f.m_faction)) + ' ' + std::to_string(f.m_nbCyborgs)
+            + ' ' + std::to_string(f.m_prodFactor) + ' ' + std::to_string(f.m_disabledTurns) + " 0\n";
+      }
+      // the model only keeps troops per destination and arrival turn, which is
+      // all Knowledge reads: they come out as one troop per bucket
+      for (int i = 0; i < getNbFactories(); ++i) {
+         const Troop& troop = m_state.m_troops[i];
+         for (int t = 1; t < TROOP_HORIZON; ++t) {
+            for (int p = 0; p < 2; ++p) {
+               const int n = troop.getNbArriving(t, getFaction(p));
+               if (n > 0)
+                  body += std::to_string(id++) + " TROOP " + std::to_string(p == player ? 1 : -1) + ' ' + std::to_string(i) + ' '
+                     + std::to_string(i) + ' ' + std::to_string(n) + ' ' + std::to_string(t) + '\n';
+            }
+         }
+      }
+      for (int i = 0; i < m_state.m_nbBombs; ++i) {
+         const Bomb& b = m_state.m_bombs[i];
+         if (b.m_faction == getFaction(player))
+            body += std::to_string(id++) + " BOMB 1 " + std::to_string(b.m_srcId) + ' ' + std::to_string(b.m_dstId) + ' '
+               + std::to_string(b.m_remainingTurns) + " 0\n";
+         else
+            body += std::to_string(id++) + " BOMB -1 " + std::to_string(b.m_srcId) + " -1 -1 0\n";
+      }
+      return std::to_string(id) + '\n' + body;
+   }
+
+   // Applies the answers of both bots and advances one turn.
+   void play(const std::string& output0, const std::string& output1) {
+      Action::Order orders[2][SIM_MAX_ORDERS];
+      const int nbOrders0 = parseOrders(output0, orders[0]);
+      const int nbOrders1 = parseOrders(output1, orders[1]);
+      m_sim.step(m_state, orders[0], nbOrders0, orders[1], nbOrders1);
+      ++m_turn;
+   }
+
+private:
+   static Faction::Type getFaction(int player) { return player == 0 ? Faction::Ally : Faction::Ennemy; }
+   static int getOwner(int player, Faction::Type faction) {
+      return faction == Faction::Neutral ? 0 : (faction == getFaction(player) ? 1 : -1);
+   }
+   // "MOVE s d n;BOMB s d;INC s;WAIT;MSG ..." into orders, returns their number.
+   static int parseOrders(const std::string& output, Action::Order* orders) {
+      int nbOrders = 0;
+      const char* cur = output.c_str();
+      while (*cur != '\0' && nbOrders < SIM_MAX_ORDERS) {
+         while (*cur == ' ' || *cur == ';')
+            ++cur;
+         char* end;
+         if (std::strncmp(cur, "MOVE", 4) == 0) {
+            const int src = static_cast<int>(std::strtol(cur + 4, &end, 10));
+            const int dst = static_cast<int>(std::strtol(end, &end, 10));
+            const int n = static_cast<int>(std::strtol(end, &end, 10));
+            orders[nbOrders++] = Action::Order(Action::Move, src, dst, n);
+            cur = end;
+         }
+         else if (std::strncmp(cur, "BOMB", 4) == 0) {
+            const int src = static_cast<int>(std::strtol(cur + 4, &end, 10));
+            const int dst = static_cast<int>(std::strtol(end, &end, 10));
+            orders[nbOrders++] = Action::Order(Action::Bomb, src, dst);
+            cur = end;
+         }
+         else if (std::strncmp(cur, "INC", 3) == 0) {
+            const int src = static_cast<int>(std::strtol(cur + 3, &end, 10));
+            orders[nbOrders++] = Action::Order(Action::IncrementProd, src);
+            cur = end;
+         }
+         // WAIT, MSG or garbage: skip to the next order
+         while (*cur != '\0' && *cur != ';')
+            ++cur;
+      }
+      return nbOrders;
+   }
+
+   std::string m_init;
+   io::Reader m_in;
+   Knowledge m_kb; // topology, shared by the simulator
+   Simulator m_sim;
+   SimState m_state;
+   int m_turn;
+};
+
+// One side of a match, fed with the referee text of each turn.
+struct IPlayer {
+   virtual ~IPlayer() {}
+   // input holds the init lines too on the first turn; returns the bot's answer.
+   virtual const std::string& play(const std::string& input) = 0;
+};
+
+// BestProdStrategy with the given weights, reading and writing memory buffers.
+struct BotPlayer : public IPlayer {
+   explicit BotPlayer(const BestProdParams& params = BestProdParams())
+      : m_in(nullptr, 0), m_writer(&m_output), m_kb(m_in), m_action(m_writer, m_kb), m_arena(TURN_ARENA_SIZE), m_strategy(m_kb, m_action, m_arena, params)
+      , m_initialized(false) {}
+   virtual const std::string& play(const std::string& input) override {
+      m_output.clear();
+      m_arena.reset();
+      m_in.reset(input.data(), input.size());
+      if (!m_initialized) {
+         m_kb.initialize();
+         m_initialized = true;
+      }
+      m_kb.step();
+      m_strategy();
+      m_action.step();
+      return m_output;
+   }
+
+   io::Reader m_in;
+   std::string m_output;
+   io::Writer m_writer;
+   Knowledge m_kb;
+   Action m_action;
+   Arena m_arena;
+   BestProdStrategy m_strategy;
+   bool m_initialized;
+};
+
+// Simulator::playGreedy, the opponent model of the search, as a player.
+struct GreedyPlayer : public IPlayer {
+   GreedyPlayer() : m_in(nullptr, 0), m_writer(&m_output), m_kb(m_in), m_sim(m_kb), m_initialized(false) {}
+   virtual const std::string& play(const std::string& input) override {
+      m_output.clear();
+      m_in.reset(input.data(), input.size());
+      if (!m_initialized) {
+         m_kb.initialize();
+         m_initialized = true;
+      }
+      m_kb.step();
+      SimState s;
+      m_sim.load(s);
+      Action::Order orders[SIM_MAX_ORDERS];
+      const int nbOrders = m_sim.playGreedy(s, Faction::Ally, orders);
+      for (int i = 0; i < nbOrders; ++i) {
+         const Action::Order& o = orders[i];
+         if (i > 0)
+            m_writer << ';';
+         if (o.m_type == Action::Move)
+            m_writer << "MOVE " << o.m_srcId << ' ' << o.m_dstId << ' ' << o.m_nbCyborgs;
+         else
+            m_writer << "INC " << o.m_srcId;
+      }
+      if (nbOrders == 0)
+         m_writer << "WAIT";
+      m_writer << '\n';
+      m_writer.flush();
+      return m_output;
+   }
+
+   io::Reader m_in;
+   std::string m_output;
+   io::Writer m_writer;
+   Knowledge m_kb;
+   Simulator m_sim;
+   bool m_initialized;
+};
+
+// Plays engine to the end, returns the winning player or -1 on a draw.
+inline int playMatch(GameEngine& engine, IPlayer& player0, IPlayer& player1) {
+   std::string input[2] = { engine.getInitInput(), engine.getInitInput() };
+   while (!engine.isOver()) {
+      input[0] += engine.getTurnInput(0);
+      input[1] += engine.getTurnInput(1);
+      const std::string& output0 = player0.play(input[0]);
+      const std::string& output1 = player1.play(input[1]);
+      engine.play(output0, output1);
+      input[0].clear();
+      input[1].clear();
+   }
+   return engine.getWinner();
+}
+
+#endif
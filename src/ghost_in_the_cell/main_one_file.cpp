@@ -1,5 +1,16 @@
+// the arena takes no compiler flags; PGO builds must not mix this pragma
+// with their profile flags (gcc then sees a different control flow)
+#ifndef CG_NO_OPTIMIZE_PRAGMA
+#pragma GCC optimize("O3")
+#endif
 
 #include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <iterator>
 #include <map>
@@ -7,24 +18,48 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <type_traits>
 #include <vector>
 
-using namespace std;
+#include "arena.hpp"
+#include "capture.hpp"
+#include "fast_io.hpp"
+#include "logging.hpp"
+#include "turn_profiler.hpp"
 
-#define LOG(x) 
-//#define LOG(x) cerr << x << endl;
+using namespace std;
 
-static const std::size_t NB_FACTORY_MAX = 15;
-static const std::string ENTITY_TYPE_FACTORY = "FACTORY";
-static const std::string ENTITY_TYPE_TROOP = "TROOP";
+// Capacity of the fixed-size tables. The arena never has more than 15
+// factories, bigger capacities are only built for stress benchmarks.
+#ifndef GITC_FACTORY_CAPACITY
+#define GITC_FACTORY_CAPACITY 15
+#endif
+static const std::size_t NB_FACTORY_MAX = GITC_FACTORY_CAPACITY;
+static const char* const ENTITY_TYPE_FACTORY = "FACTORY";
+static const char* const ENTITY_TYPE_TROOP = "TROOP";
+static const char* const ENTITY_TYPE_BOMB = "BOMB";
 
 static const std::size_t UPGRADE_COST = 10;
+static const int PROD_FACTOR_MAX = 3;
+static const int NB_BOMBS = 2;
+static const int BOMB_DISABLED_TURNS = 5;
+static const int BOMB_MIN_DESTROYED = 10;
 
 static const double W_DISTANCE = 9;
 static const double W_PROD = 2;
 static const double W_ENNEMY = 1.2;
 static const double W_BOMB_TRIGGER = 2;
 
+// Strategy played by the bot unless GITC_STRATEGY is set in the environment:
+// bestprod, search or random (which plays bestprod).
+#ifndef GITC_STRATEGY
+#define GITC_STRATEGY "bestprod"
+#endif
+static const double TURN_TIMEOUT_MS = 50; // the referee allows 50ms per turn
+static const double SEARCH_BUDGET_MS = 40;
+static const double SEARCH_MARGIN_MS = 1; // kept free on top of twice the worst rollout, the first one included
+static const int SEARCH_HORIZON = 20;
+
 struct Faction {
    enum Type {
       Neutral,
@@ -32,7 +67,7 @@ struct Faction {
       Ennemy,
       Unknown
    };
-   static std::string toString(int t) {
+   static const char* toString(int t) {
       switch (t) {
       case Ally:      return "Ally";
       case Ennemy:    return "Ennemy";
@@ -55,201 +90,440 @@ ostream& operator<<(ostream& os, const Faction::Type& t) {
 
 struct Factory {
    Factory()
-      : m_id(-1), m_nbCyborgs(0), m_prodFactor(0), m_faction(Faction::Neutral) {}
-   Factory(int id, int nbCyborgs, Faction::Type faction, int prodFactor)
-      : m_id(id), m_nbCyborgs(nbCyborgs), m_prodFactor(prodFactor), m_faction(faction) {}
+      : m_id(-1), m_nbCyborgs(0), m_prodFactor(0), m_faction(Faction::Neutral), m_disabledTurns(0) {}
+   Factory(int id, int nbCyborgs, Faction::Type faction, int prodFactor, int disabledTurns = 0)
+      : m_id(id), m_nbCyborgs(nbCyborgs), m_prodFactor(prodFactor), m_faction(faction), m_disabledTurns(disabledTurns) {}
    bool isAlly() const { return m_faction == Faction::Ally; };
    bool isEnnemy() const { return m_faction == Faction::Ennemy; };
    bool isNeutral() const { return m_faction == Faction::Neutral; };
+   // Cyborgs of attacker reaching the factory once arriving troops fought each other.
+   void solveBattle(Faction::Type attacker, int nbAttackers) {
+      if (m_faction == attacker) {
+         m_nbCyborgs += nbAttackers;
+         return;
+      }
+      m_nbCyborgs -= nbAttackers;
+      if (m_nbCyborgs < 0) {
+         m_faction = attacker;
+         m_nbCyborgs = -m_nbCyborgs;
+      }
+   }
    int m_id;
    int m_nbCyborgs;
    int m_prodFactor;
    Faction::Type m_faction;
+   int m_disabledTurns;
 };
 typedef std::vector<Factory> T_Factories;
 
+static const int LINK_DISTANCE_MAX = 20; // turns between two factories, by the rules
+static const int TROOP_HORIZON = LINK_DISTANCE_MAX + 1; // arriving now, then 1 to LINK_DISTANCE_MAX turns away
+
+// Cyborgs heading to one factory, bucketed by turns before arrival in a ring
+// buffer: adding a troop is O(1) and a turn passing only moves the head.
+// A bucket holds at most the cyborgs of one side, far below 2^16.
 struct Troop {
-   Troop(int targetId) : m_targetId(targetId)
+   Troop(int targetId = -1) : m_targetId(targetId), m_head(0)
    {
       m_nbCyborgs[Faction::Neutral] = 0;
       m_nbCyborgs[Faction::Ally] = 0;
       m_nbCyborgs[Faction::Ennemy] = 0;
+      std::fill(&m_arrivals[0][0], &m_arrivals[0][0] + 2 * TROOP_HORIZON, 0);
+   }
+   static int side(Faction::Type faction) { return faction == Faction::Ally ? 0 : 1; }
+   int getNbArriving(int remainingTurns, Faction::Type faction) const {
+      return m_arrivals[slot(remainingTurns)][side(faction)];
+   }
+   void add(Faction::Type faction, int nbCyborgs, int remainingTurns) {
+      m_arrivals[slot(std::min(remainingTurns, TROOP_HORIZON - 1))][side(faction)] += nbCyborgs;
+      m_nbCyborgs[faction] += nbCyborgs;
+   }
+   // One turn passes: troops one turn away are now arriving.
+   void shift() {
+      if (++m_head == TROOP_HORIZON)
+         m_head = 0;
+   }
+   // Removes the troops arriving this turn, returns the winning side of their fight (Neutral if none left).
+   Faction::Type land(int& nbAttackers) {
+      std::uint16_t* arriving = m_arrivals[m_head];
+      m_nbCyborgs[Faction::Ally] -= arriving[0];
+      m_nbCyborgs[Faction::Ennemy] -= arriving[1];
+      nbAttackers = std::abs(arriving[0] - arriving[1]);
+      auto winner = nbAttackers == 0 ? Faction::Neutral : (arriving[0] > arriving[1] ? Faction::Ally : Faction::Ennemy);
+      arriving[0] = 0;
+      arriving[1] = 0;
+      return winner;
+   }
+   // Owner and garrison of factory in nbTurns if nobody sends anything more, in O(nbTurns).
+   Factory projectedGarrison(Factory factory, int nbTurns) const {
+      for (int t = 1; t <= std::min(nbTurns, TROOP_HORIZON - 1); ++t) {
+         if (factory.m_disabledTurns > 0)
+            --factory.m_disabledTurns;
+         else if (!factory.isNeutral())
+            factory.m_nbCyborgs += factory.m_prodFactor;
+         auto a = getNbArriving(t, Faction::Ally);
+         auto e = getNbArriving(t, Faction::Ennemy);
+         if (a != e)
+            factory.solveBattle(a > e ? Faction::Ally : Faction::Ennemy, std::abs(a - e));
+      }
+      return factory;
    }
    int m_targetId;
-   int m_nbCyborgs[Faction::Unknown];
+   int m_nbCyborgs[Faction::Unknown]; // in flight, whatever the arrival turn
+   std::uint16_t m_arrivals[TROOP_HORIZON][2]; // [ally, ennemy]
+   int m_head; // in [0, TROOP_HORIZON)
+private:
+   // remainingTurns in [0, TROOP_HORIZON)
+   int slot(int remainingTurns) const {
+      const int i = m_head + remainingTurns;
+      return i < TROOP_HORIZON ? i : i - TROOP_HORIZON;
+   }
 };
 typedef std::vector<Troop> T_Troops;
 
-struct Knowledge {
-private:
-   Knowledge(const Knowledge& o)
-      : m_localKb(), m_factories(o.m_factories), m_troops(o.m_troops)
-      , m_distances(o.m_distances), m_availableBombs(o.m_availableBombs)
-      , m_safeDistances(o.m_safeDistances), m_nbTotalCyborgs(o.m_nbTotalCyborgs)
-   {
-      m_bombTargetId[0] = o.m_bombTargetId[0];
-      m_bombTargetId[1] = o.m_bombTargetId[1];
-   }
-   void operator=(const Knowledge& o) {
-      m_factories = o.m_factories;
-      m_troops = o.m_troops;
-      m_availableBombs = o.m_availableBombs;
-      m_nbTotalCyborgs = o.m_nbTotalCyborgs;
-      m_bombTargetId[0] = o.m_bombTargetId[0];
-      m_bombTargetId[1] = o.m_bombTargetId[1];
-      m_safeDistances = o.m_safeDistances;
-   }
-   std::auto_ptr<Knowledge> m_localKb;
-
-
-public:
-   T_Factories m_factories;
-   T_Troops m_troops;
-   std::vector<std::vector<double> > m_distances;
-   std::vector<std::vector<std::pair<double /*distance*/, int/*from*/> > > m_safeDistances;
+struct Bomb {
+   Bomb() : m_faction(Faction::Neutral), m_srcId(-1), m_dstId(-1), m_remainingTurns(0) {}
+   Bomb(Faction::Type faction, int srcId, int dstId, int remainingTurns)
+      : m_faction(faction), m_srcId(srcId), m_dstId(dstId), m_remainingTurns(remainingTurns) {}
+   Faction::Type m_faction;
+   int m_srcId;
+   int m_dstId; // -1 when ennemy
+   int m_remainingTurns; // -1 when ennemy
+};
+
+// Turn dependent part of the knowledge. Trivially copyable so that the
+// read -> decision handoff is a plain memcpy of about 2KB.
+struct KnowledgeState {
+   Factory m_factories[NB_FACTORY_MAX];
+   Troop m_troops[NB_FACTORY_MAX];
+   Bomb m_bombs[2 * NB_BOMBS]; // bombs in flight
+   int m_nbBombs;
    int m_availableBombs;
    int m_nbTotalCyborgs;
    int m_bombTargetId[2];
 
-   Knowledge() {}
+   bool hasAvailableBomb() const { return m_availableBombs != 0; }
+   bool isAlreadyTargeted(int idx) const { return m_bombTargetId[0] == idx || m_bombTargetId[1] == idx; }
+};
+static_assert(std::is_trivially_copyable<KnowledgeState>::value, "KnowledgeState is memcpy'ed every turn");
+
+// Factories of each faction in id order, and for every factory the closest
+// factory of each faction (-1 if none). Rebuilt only when an owner changes.
+struct FactionIndex {
+   void reset(int nbFactories) {
+      m_nbFactories = nbFactories;
+      std::fill(m_owners, m_owners + NB_FACTORY_MAX, Faction::Unknown);
+      std::fill(m_sizes, m_sizes + Faction::Unknown, 0);
+   }
+   // returns true if the owner changed
+   bool setOwner(int id, Faction::Type faction) {
+      auto changed = m_owners[id] != faction;
+      m_owners[id] = faction;
+      return changed;
+   }
+   void rebuild(const double* distances) {
+      std::fill(m_sizes, m_sizes + Faction::Unknown, 0);
+      for (int i = 0; i < m_nbFactories; ++i)
+         m_ids[m_owners[i]][m_sizes[m_owners[i]]++] = i;
+      for (int f = 0; f < Faction::Unknown; ++f) {
+         for (int t = 0; t < m_nbFactories; ++t) {
+            const double* distancesFromTarget = distances + t * m_nbFactories;
+            auto id = -1;
+            auto minD = std::numeric_limits<double>::max();
+            for (int k = 0; k < m_sizes[f]; ++k) {
+               auto d = distancesFromTarget[m_ids[f][k]];
+               if (d <= minD) {
+                  minD = d;
+                  id = m_ids[f][k];
+               }
+            }
+            m_closest[f][t] = id;
+         }
+      }
+   }
+   int getSize(Faction::Type faction) const { return m_sizes[faction]; }
+   const int* getIds(Faction::Type faction) const { return m_ids[faction]; }
+   int getClosest(int targetId, Faction::Type faction) const { return m_closest[faction][targetId]; }
+
+   int m_nbFactories;
+   Faction::Type m_owners[NB_FACTORY_MAX];
+   int m_ids[Faction::Unknown][NB_FACTORY_MAX];
+   int m_sizes[Faction::Unknown];
+   int m_closest[Faction::Unknown][NB_FACTORY_MAX];
+};
+
+// A troop as listed by the referee.
+struct TroopSighting {
+   // Same troop one turn later.
+   bool isFollowedBy(const TroopSighting& next) const {
+      return next.m_id == m_id && next.m_faction == m_faction && next.m_srcId == m_srcId && next.m_dstId == m_dstId
+         && next.m_nbCyborgs == m_nbCyborgs && next.m_remainingTurns == m_remainingTurns - 1;
+   }
+   int m_id;
+   Faction::Type m_faction;
+   int m_srcId;
+   int m_dstId;
+   int m_nbCyborgs;
+   int m_remainingTurns;
+};
+
+struct Knowledge {
+   // static topology, shared by both buffers
+   // all matrices are row major, m_nbFactories x m_nbFactories
+   std::vector<double> m_distances; // normalized link distances
+   std::vector<int> m_linkDistances; // raw turns between factories
+   std::vector<int> m_safeDistances; // shortest path turns
+   std::vector<int> m_nextHops; // first factory on the shortest path
+
+   explicit Knowledge(io::Reader& in) : m_in(in), m_factionsChanged(false), m_nbFactories(0), m_readIdx(0) {}
    void initialize() {
-      LOG("======== init.knowledge");
-      int factoryCount; // the number of factories
-      cin >> factoryCount; cin.ignore();
-      int linkCount; // the number of links between factories
-      cin >> linkCount; cin.ignore();
-      LOG("======== init.knowledge.factoryCount " << factoryCount);
-      std::pair<int, int> distanceRange(std::numeric_limits<int>::max(), std::numeric_limits<int>::min());
-      m_distances.resize(factoryCount);
-      for (int i = 0; i < factoryCount; i++) {
-         m_distances[i].resize(factoryCount);
-         for (int j = 0; j < factoryCount; j++)
-            m_distances[i][j] = std::numeric_limits<int>::max();
+      LOG_DEBUG("======== init.knowledge");
+      int factoryCount = m_in.readInt(); // the number of factories
+      int linkCount = m_in.readInt(); // the number of links between factories
+      LOG_DEBUG("======== init.knowledge.factoryCount {}", factoryCount);
+      // every per-factory table is sized NB_FACTORY_MAX (GITC_FACTORY_CAPACITY)
+      assert(factoryCount >= 0 && factoryCount <= static_cast<int>(NB_FACTORY_MAX));
+      if (factoryCount < 0 || factoryCount > static_cast<int>(NB_FACTORY_MAX)) {
+         LOG_ERROR("{} factories, only {} handled", factoryCount, NB_FACTORY_MAX);
+         factoryCount = std::max(0, std::min(factoryCount, static_cast<int>(NB_FACTORY_MAX)));
       }
+      m_nbFactories = factoryCount;
+      std::pair<int, int> distanceRange(std::numeric_limits<int>::max(), std::numeric_limits<int>::min());
+      m_distances.assign(factoryCount * factoryCount, std::numeric_limits<int>::max());
+      m_linkDistances.assign(factoryCount * factoryCount, 0);
       for (int i = 0; i < linkCount; i++) {
-         int factory1, factory2, distance;
-         cin >> factory1 >> factory2 >> distance; cin.ignore();
+         int factory1 = m_in.readInt();
+         int factory2 = m_in.readInt();
+         int distance = m_in.readInt();
+         assert(isFactoryId(factory1) && isFactoryId(factory2));
+         if (!isFactoryId(factory1) || !isFactoryId(factory2))
+            continue;
 
-         m_distances[factory1][factory2] = distance;
-         m_distances[factory2][factory1] = distance;
+         m_distances[factory1 * factoryCount + factory2] = distance;
+         m_distances[factory2 * factoryCount + factory1] = distance;
+         m_linkDistances[factory1 * factoryCount + factory2] = distance;
+         m_linkDistances[factory2 * factoryCount + factory1] = distance;
          distanceRange.first = std::min(distanceRange.first, distance);
          distanceRange.second = std::max(distanceRange.second, distance);
-         LOG(factory1 << "->" << factory2 << ":" << distance);
+         LOG_DEBUG("{}->{}:{}", factory1, factory2, distance);
       }
       //
-      m_availableBombs = 2;
-      m_bombTargetId[0] = -1;
-      m_bombTargetId[1] = -1;
-      m_factories.resize(factoryCount);
-      m_troops.reserve(factoryCount);
+      KnowledgeState& s = m_states[m_readIdx];
+      s = KnowledgeState();
+      s.m_availableBombs = NB_BOMBS;
+      s.m_bombTargetId[0] = -1;
+      s.m_bombTargetId[1] = -1;
       for (int i = 0; i < factoryCount; ++i)
-         m_troops.push_back(Troop(i));
+         s.m_troops[i] = Troop(i);
+      for (auto& sightings : m_troopSightings) {
+         sightings.clear();
+         sightings.reserve(4 * NB_FACTORY_MAX);
+      }
+      m_factions.reset(factoryCount);
 
       initializeSafeDistances();
       // normalize distance
       double normalizeRatio = 0.1 * (distanceRange.second - distanceRange.first);
-      for (auto& di : m_distances) {
-         for (auto& dj : di) {
-            dj /= normalizeRatio;
-         }
-      }
-      m_localKb.reset(new Knowledge(*this));
-
+      for (auto& d : m_distances)
+         d /= normalizeRatio;
+      m_states[m_readIdx ^ 1] = s;
    }
    void terminate() {
-      LOG("======== terminate.knowledge");
-      m_localKb.reset();
-      m_factories.clear();
+      LOG_DEBUG("======== terminate.knowledge");
+      m_nbFactories = 0;
    }
-   Knowledge& getLocalKnowledge() const {
-      return *m_localKb;
+   // Scratch copy of the current turn, owned by the decision.
+   KnowledgeState& getLocalKnowledge() const {
+      return m_states[m_readIdx ^ 1];
    }
-   void step() {
-      LOG("======== step.knowledge");
-      LOG("======== step.knowledge.local.read");
-      // flip/flop local kb
-      {
-         m_availableBombs = m_localKb->m_availableBombs;
-         m_bombTargetId[0] = m_localKb->m_bombTargetId[0];
-         m_bombTargetId[1] = m_localKb->m_bombTargetId[1];
-      }
+   // Current turn as read from the referee.
+   const KnowledgeState& getState() const {
+      return m_states[m_readIdx];
+   }
+   // Returns false once the referee closed the input.
+   bool step() {
+      LOG_DEBUG("======== step.knowledge");
+      // flip/flop: the local buffer of the previous turn carries the decision
+      // bookkeeping (bombs) and becomes the read buffer.
+      m_readIdx ^= 1;
+      KnowledgeState& s = m_states[m_readIdx];
+      LOG_DEBUG("======== step.knowledge.local.read");
       // reset step independent data
       {
-         m_nbTotalCyborgs = 0;
-         for (int i = 0; i < m_troops.size(); ++i)
-            m_troops[i] = Troop(i);
+         s.m_nbTotalCyborgs = 0;
+         s.m_nbBombs = 0;
+         m_troopSightings[1].clear();
+         m_factionsChanged = false;
          int entityCount = 0; // the number of entities (e.g. factories and troops)
-         cin >> entityCount; cin.ignore();
+         if (!m_in.readInt(entityCount))
+            return false;
          for (int i = 0; i < entityCount; i++) {
-            string entityType;
-            int entityId, arg1, arg2, arg3, arg4, arg5;
-            cin >> entityId >> entityType >> arg1 >> arg2 >> arg3 >> arg4 >> arg5; cin.ignore();
+            char entityType[8];
+            int entityId = m_in.readInt();
+            m_in.readWord(entityType, sizeof(entityType));
+            int arg1 = m_in.readInt();
+            int arg2 = m_in.readInt();
+            int arg3 = m_in.readInt();
+            int arg4 = m_in.readInt();
+            int arg5 = m_in.readInt();
 
-            if (entityType == ENTITY_TYPE_FACTORY)
-               updateFactory(entityId, Faction::fromInt(arg1), arg2, arg3);
+            const bool isFactory = std::strcmp(entityType, ENTITY_TYPE_FACTORY) == 0;
+            const bool isBomb = std::strcmp(entityType, ENTITY_TYPE_BOMB) == 0;
+            // the tables are indexed by factory id; an ennemy bomb has no known target
+            const bool isValid = isFactory ? isFactoryId(entityId) : isFactoryId(arg2) && (isBomb || isFactoryId(arg3));
+            assert(isValid);
+            if (!isValid) {
+               LOG_ERROR("{} {} refers to an unknown factory", isFactory ? ENTITY_TYPE_FACTORY : (isBomb ? ENTITY_TYPE_BOMB : ENTITY_TYPE_TROOP), entityId);
+               continue;
+            }
+            if (isFactory)
+               updateFactory(s, entityId, Faction::fromInt(arg1), arg2, arg3, arg4);
+            else if (isBomb)
+               updateBomb(s, entityId, Faction::fromInt(arg1), arg2, arg3, arg4);
             else /*if (entityId == ENTITY_TYPE_TROOP)*/
-               updateTroop(entityId, Faction::fromInt(arg1), arg2, arg3, arg4, arg5);
+               updateTroop(s, entityId, Faction::fromInt(arg1), arg2, arg3, arg4, arg5);
          }
+         updateTroops(s);
+         if (m_factionsChanged)
+            m_factions.rebuild(m_distances.data());
       }
-      LOG("======== step.knowledge.local.write");
-      *m_localKb = *this;
+      LOG_DEBUG("======== step.knowledge.local.write");
+      m_states[m_readIdx ^ 1] = s;
+      return true;
    }
-   int getNbFactories() const { return static_cast<int>(m_factories.size()); };
-   const Factory& getFactory(int idx) const { return m_factories[idx]; }
-   Factory& getFactory(int idx) { return m_factories[idx]; }
-   bool hasAvailableBomb() const { return m_availableBombs != 0; }
-   bool isAlreadyTargeted(int idx) const { return m_bombTargetId[0] == idx || m_bombTargetId[1] == idx; }
-   int getNextStepToGoTo(int srcId, int targetId) {
-      if (srcId == targetId)
-         return srcId;
-      int nextStep;
-      do {
-         nextStep = targetId;
-         targetId = m_safeDistances[srcId][targetId].second;
-      } while (targetId != srcId);
-      return nextStep;
+   int getNbFactories() const { return m_nbFactories; };
+   bool isFactoryId(int id) const { return id >= 0 && id < m_nbFactories; }
+   const FactionIndex& getFactions() const { return m_factions; }
+   const Factory& getFactory(int idx) const { return getState().m_factories[idx]; }
+   const double* getDistances(int srcId) const { return &m_distances[srcId * m_nbFactories]; }
+   int getLinkDistance(int srcId, int dstId) const { return m_linkDistances[srcId * m_nbFactories + dstId]; }
+   int getSafeDistance(int srcId, int dstId) const { return m_safeDistances[srcId * m_nbFactories + dstId]; }
+   int getNextStepToGoTo(int srcId, int targetId) const { return m_nextHops[srcId * m_nbFactories + targetId]; }
+   // Fills path with the factories after srcId up to targetId, returns the number of hops.
+   int getPath(int srcId, int targetId, int* path) const {
+      int nbHops = 0;
+      while (srcId != targetId) {
+         srcId = getNextStepToGoTo(srcId, targetId);
+         path[nbHops++] = srcId;
+      }
+      return nbHops;
    }
 private:
-   void updateFactory(int entityId, Faction::Type faction, int nbCyborgs, int prodFactor) {
-      LOG("+ update factory: " << entityId << " " << nbCyborgs << " " << faction << " " << prodFactor);
-      m_factories[entityId] = Factory(entityId, nbCyborgs, faction, prodFactor);
-      m_nbTotalCyborgs += nbCyborgs;
+   void updateFactory(KnowledgeState& s, int entityId, Faction::Type faction, int nbCyborgs, int prodFactor, int disabledTurns) {
+      LOG_DEBUG("+ update factory: {} {} {} {}", entityId, nbCyborgs, Faction::toString(faction), prodFactor);
+      s.m_factories[entityId] = Factory(entityId, nbCyborgs, faction, prodFactor, disabledTurns);
+      s.m_nbTotalCyborgs += nbCyborgs;
+      m_factionsChanged |= m_factions.setOwner(entityId, faction);
    }
-   void updateTroop(int entityId, Faction::Type faction, int srcFactoryId, int dstFactoryId, int nbCyborgs, int distance) {
-      LOG("+ update troop: " << faction << " " << entityId << " " << srcFactoryId << "->" << dstFactoryId << " (" << nbCyborgs << ")");
-      m_troops[dstFactoryId].m_nbCyborgs[faction] += nbCyborgs;
-      m_nbTotalCyborgs += nbCyborgs;
+   void updateTroop(KnowledgeState& s, int entityId, Faction::Type faction, int srcFactoryId, int dstFactoryId, int nbCyborgs, int distance) {
+      LOG_DEBUG("+ update troop: {} {} {}->{} ({})", Faction::toString(faction), entityId, srcFactoryId, dstFactoryId, nbCyborgs);
+      TroopSighting troop = { entityId, faction, srcFactoryId, dstFactoryId, nbCyborgs, distance };
+      m_troopSightings[1].push_back(troop);
+      s.m_nbTotalCyborgs += nbCyborgs;
    }
-   void initializeSafeDistances() {
-      // FloydWarshall
-      m_safeDistances.resize(m_factories.size());
-      for (auto i = 0; i < m_safeDistances.size(); ++i) {
-         m_safeDistances[i].resize(m_factories.size());
-         for (auto j = 0; j < m_safeDistances.size(); ++j) {
-            m_safeDistances[i][j] = std::make_pair(m_distances[i][j], i);
-            if (i == j)
-               m_safeDistances[i][j] = std::make_pair(0, i);
+   // s holds the troops of the previous turn. When the troops read continue
+   // them (the referee keeps ids and only brings troops closer) the rings
+   // advance one turn and take the new troops, otherwise they are rebuilt.
+   void updateTroops(KnowledgeState& s) {
+      std::vector<TroopSighting>& previous = m_troopSightings[0];
+      std::vector<TroopSighting>& current = m_troopSightings[1];
+      if (continuesPreviousTroops()) {
+         const int lastId = previous.empty() ? -1 : previous.back().m_id;
+         for (int i = 0; i < m_nbFactories; ++i) {
+            int nbAttackers;
+            s.m_troops[i].shift();
+            s.m_troops[i].land(nbAttackers); // landed before this turn was read
+         }
+         for (const TroopSighting& t : current) {
+            if (t.m_id > lastId)
+               s.m_troops[t.m_dstId].add(t.m_faction, t.m_nbCyborgs, t.m_remainingTurns);
          }
       }
-      for (auto k = 0; k < m_safeDistances.size(); ++k) {
-         for (auto i = 0; i < m_safeDistances.size(); ++i) {
-            for (auto j = 0; j < m_safeDistances.size(); ++j) {
-               auto distance = m_safeDistances[i][k].first + m_safeDistances[k][j].first;
-               if (distance < m_safeDistances[i][j].first) {
-                  m_safeDistances[i][j].first = distance;
-                  m_safeDistances[i][j].second = k;
-               }
-            }
+      else {
+         LOG_DEBUG("+ troops rebuilt");
+         for (int i = 0; i < m_nbFactories; ++i)
+            s.m_troops[i] = Troop(i);
+         for (const TroopSighting& t : current)
+            s.m_troops[t.m_dstId].add(t.m_faction, t.m_nbCyborgs, t.m_remainingTurns);
+      }
+      previous.swap(current);
+   }
+   // Every troop read is either a troop of the previous turn one turn closer
+   // or a new one with a higher id, and the troops gone have landed.
+   bool continuesPreviousTroops() const {
+      const std::vector<TroopSighting>& previous = m_troopSightings[0];
+      const std::vector<TroopSighting>& current = m_troopSightings[1];
+      const int lastId = previous.empty() ? -1 : previous.back().m_id;
+      std::size_t j = 0;
+      int id = -1;
+      for (const TroopSighting& t : current) {
+         if (t.m_id <= id)
+            return false;
+         id = t.m_id;
+         for (; j < previous.size() && previous[j].m_id < t.m_id; ++j) {
+            if (previous[j].m_remainingTurns > 1)
+               return false;
          }
+         if (j < previous.size() && previous[j].m_id == t.m_id) {
+            // a troop beyond the horizon was clamped, its bucket is not exact
+            if (!previous[j].isFollowedBy(t) || previous[j].m_remainingTurns >= TROOP_HORIZON)
+               return false;
+            ++j;
+         }
+         else if (t.m_id < lastId)
+            return false;
       }
-      /*std::cerr << "##################" << std::endl;
-      for (auto i = 0; i < m_safeDistances.size(); ++i) {
-      for (auto j = 0; j < m_safeDistances.size(); ++j) {
-      std::cerr << "# " << i <<"->" <<j << " : " << m_safeDistances[i][j].first << " from #" << m_safeDistances[i][j].second << std::endl;
+      for (; j < previous.size(); ++j) {
+         if (previous[j].m_remainingTurns > 1)
+            return false;
       }
+      return true;
+   }
+   void updateBomb(KnowledgeState& s, int entityId, Faction::Type faction, int srcFactoryId, int dstFactoryId, int remainingTurns) {
+      LOG_DEBUG("+ update bomb: {} {} {}->{} ({})", Faction::toString(faction), entityId, srcFactoryId, dstFactoryId, remainingTurns);
+      if (s.m_nbBombs < 2 * NB_BOMBS)
+         s.m_bombs[s.m_nbBombs++] = Bomb(faction, srcFactoryId, dstFactoryId, remainingTurns);
+   }
+   void initializeSafeDistances() {
+      // FloydWarshall with next hops, branchless inner loop over flat rows so it vectorizes
+      static const int NO_LINK = 1 << 29;
+      const int n = m_nbFactories;
+      m_safeDistances.resize(n * n);
+      m_nextHops.resize(n * n);
+      for (int i = 0; i < n; ++i) {
+         for (int j = 0; j < n; ++j) {
+            auto d = m_linkDistances[i * n + j];
+            m_safeDistances[i * n + j] = i == j ? 0 : (d > 0 ? d : NO_LINK);
+            m_nextHops[i * n + j] = j;
+         }
+      }
+      for (int k = 0; k < n; ++k) {
+         const int* __restrict dk = &m_safeDistances[k * n];
+         for (int i = 0; i < n; ++i) {
+            if (i == k)
+               continue;
+            int* __restrict di = &m_safeDistances[i * n];
+            int* __restrict hi = &m_nextHops[i * n];
+            const int dik = di[k];
+            const int hik = hi[k];
+            for (int j = 0; j < n; ++j) {
+               const int distance = dik + dk[j];
+               const int d = di[j];
+               const int shorter = -static_cast<int>(distance < d);
+               hi[j] = (hik & shorter) | (hi[j] & ~shorter);
+               di[j] = std::min(distance, d);
+            }
+         }
       }
-      std::cerr << "##################" << std::endl;*/
    }
+
+   io::Reader& m_in;
+   FactionIndex m_factions;
+   bool m_factionsChanged;
+   int m_nbFactories;
+   int m_readIdx;
+   mutable KnowledgeState m_states[2];
+   std::vector<TroopSighting> m_troopSightings[2]; // [previous turn, this turn], in id order
 };
 
 struct Action {
@@ -260,6 +534,8 @@ struct Action {
       IncrementProd
    };
    struct Order {
+      Order()
+         : m_type(Wait), m_srcId(-1), m_dstId(-1), m_nbCyborgs(0) {}
       Order(Type type, int srcFactoryId, int dstFactoryId = 0, int nbCyborgs = 0)
          : m_type(type), m_srcId(srcFactoryId), m_dstId(dstFactoryId), m_nbCyborgs(nbCyborgs) {}
       Type m_type;
@@ -268,306 +544,794 @@ struct Action {
       int m_nbCyborgs;
    };
 
+   // Orders of a turn, one per (type, src, dst) once merged.
+   static constexpr int MAX_ORDERS = NB_FACTORY_MAX * NB_FACTORY_MAX + NB_FACTORY_MAX;
+
+   // Orders are checked against the turn as read from the referee.
+   Action(io::Writer& out, const Knowledge& kb) : m_out(out), m_kb(kb), m_nbOrders(0)
+   {
+      std::fill(&m_slots[0][0][0], &m_slots[0][0][0] + 3 * NB_FACTORY_MAX * NB_FACTORY_MAX, -1);
+      std::fill(m_committed, m_committed + NB_FACTORY_MAX, 0);
+   }
    void initialize() {}
-   void terminate() { m_orders.clear(); }
-   void pushOrder(const Order& order) {
-      LOG("+ pushOrder: " << order.m_type << " " << order.m_srcId << " " << order.m_dstId << " " << order.m_nbCyborgs);
-      m_orders.push_back(order);
+   void terminate() { clear(); }
+   // In O(1): orders the referee would reject or ignore are dropped, moves
+   // are capped by what is left in their factory and merged per (src, dst),
+   // INC and BOMB are kept once per target. Returns false if the order is dropped.
+   bool pushOrder(const Order& order) {
+      LOG_DEBUG("+ pushOrder: {} {} {} {}", order.m_type, order.m_srcId, order.m_dstId, order.m_nbCyborgs);
+      const int nbFactories = m_kb.getNbFactories();
+      if (order.m_type == Wait || order.m_srcId < 0 || order.m_srcId >= nbFactories)
+         return false;
+      const Factory& src = m_kb.getFactory(order.m_srcId);
+      if (!src.isAlly())
+         return false;
+      const int dstId = order.m_type == IncrementProd ? 0 : order.m_dstId;
+      if (order.m_type != IncrementProd && (dstId < 0 || dstId >= nbFactories || dstId == order.m_srcId))
+         return false;
+      int& slot = m_slots[order.m_type - Move][order.m_srcId][dstId];
+      int& committed = m_committed[order.m_srcId];
+      const int available = src.m_nbCyborgs - committed;
+      int nbCyborgs = 0;
+      if (order.m_type == Move)
+         nbCyborgs = std::min(order.m_nbCyborgs, available);
+      else if (order.m_type == IncrementProd) {
+         if (slot != -1 || src.m_prodFactor >= PROD_FACTOR_MAX || available < static_cast<int>(UPGRADE_COST))
+            return false;
+         nbCyborgs = UPGRADE_COST; // paid when the referee reads the order
+      }
+      else if (slot != -1)
+         return false;
+      if ((order.m_type != Bomb && nbCyborgs <= 0) || (slot == -1 && m_nbOrders == MAX_ORDERS))
+         return false;
+      committed += nbCyborgs;
+      if (slot != -1) {
+         m_orders[slot].m_nbCyborgs += nbCyborgs;
+         return true;
+      }
+      slot = m_nbOrders;
+      m_orders[m_nbOrders++] = Order(order.m_type, order.m_srcId, dstId, order.m_type == Move ? nbCyborgs : 0);
+      return true;
    }
+   int getNbOrders() const { return m_nbOrders; }
+   const Order& getOrder(int idx) const { return m_orders[idx]; }
    void step() {
-      LOG("======== step.action ============");
-      if (m_orders.empty()) {
+      LOG_DEBUG("======== step.action ============");
+      if (m_nbOrders == 0) {
          doWait();
       }
       else {
-         int orderCount = 0;
-         std::vector<Order> unfinishedOrders;
-         for (int i = 0; i < m_orders.size(); ++i) {
-            auto& o = m_orders[i];
-            if (orderCount++ > 0)
-               cout << ";";
-            if (!doOrder(o))
-               unfinishedOrders.push_back(o);
+         for (int i = 0; i < m_nbOrders; ++i) {
+            if (i > 0)
+               m_out << ';';
+            doOrder(m_orders[i]);
          }
-         m_orders.clear();
-         m_orders.swap(unfinishedOrders);
       }
+      clear();
 
-      cout << std::endl;
+      m_out << '\n';
+      m_out.flush();
    }
 
 private:
+   void clear() {
+      for (int i = 0; i < m_nbOrders; ++i) {
+         const Order& o = m_orders[i];
+         m_slots[o.m_type - Move][o.m_srcId][o.m_dstId] = -1;
+         m_committed[o.m_srcId] = 0;
+      }
+      m_nbOrders = 0;
+   }
    void doWait() {
-      std::cout << "WAIT";
+      m_out << "WAIT";
    }
-   bool doOrder(const Order& o) {
+   void doOrder(const Order& o) {
       if (o.m_type == Move)
-         std::cout << "MOVE " << o.m_srcId << " " << o.m_dstId << " " << o.m_nbCyborgs;
+         m_out << "MOVE " << o.m_srcId << ' ' << o.m_dstId << ' ' << o.m_nbCyborgs;
       else if (o.m_type == Bomb)
-         std::cout << "BOMB " << o.m_srcId << " " << o.m_dstId;
+         m_out << "BOMB " << o.m_srcId << ' ' << o.m_dstId;
       else if (o.m_type == IncrementProd)
-         std::cout << "INC " << o.m_srcId;
-      return true;
+         m_out << "INC " << o.m_srcId;
    }
-   std::vector<Order> m_orders;
+   io::Writer& m_out;
+   const Knowledge& m_kb;
+   Order m_orders[MAX_ORDERS];
+   int m_nbOrders;
+   int m_slots[3][NB_FACTORY_MAX][NB_FACTORY_MAX]; // [type - Move][src][dst] -> index in m_orders, -1 if none
+   int m_committed[NB_FACTORY_MAX]; // cyborgs of src spent by the orders so far
+};
+
+// Deterministic forward model of the referee, applied on a flat copy of the knowledge.
+// A turn is: move troops/bombs, execute orders, produce, solve battles, explode bombs.
+static const int SIM_MAX_ORDERS = 2 * NB_FACTORY_MAX + NB_BOMBS;
+
+struct SimState {
+   Factory m_factories[NB_FACTORY_MAX];
+   Troop m_troops[NB_FACTORY_MAX];
+   Bomb m_bombs[2 * NB_BOMBS];
+   int m_nbBombs;
+   int m_availableBombs[2];
+   int m_turn;
+
+   static int side(Faction::Type faction) { return Troop::side(faction); }
+};
+
+struct Simulator {
+   explicit Simulator(const Knowledge& kb)
+      : m_kb(kb) {}
+
+   void load(SimState& s) const {
+      const KnowledgeState& state = m_kb.getState();
+      const KnowledgeState& localKb = m_kb.getLocalKnowledge();
+      for (int i = 0; i < getNbFactories(); ++i) {
+         s.m_factories[i] = state.m_factories[i];
+         s.m_troops[i] = state.m_troops[i];
+      }
+      s.m_turn = 0;
+      s.m_nbBombs = 0;
+      for (int i = 0; i < state.m_nbBombs; ++i)
+         if (state.m_bombs[i].m_dstId != -1)
+            s.m_bombs[s.m_nbBombs++] = state.m_bombs[i];
+      s.m_availableBombs[0] = localKb.m_availableBombs;
+      s.m_availableBombs[1] = NB_BOMBS;
+      for (int i = 0; i < state.m_nbBombs; ++i)
+         if (state.m_bombs[i].m_faction == Faction::Ennemy)
+            --s.m_availableBombs[1];
+   }
+   void step(SimState& s, const Action::Order* allyOrders, int nbAllyOrders, const Action::Order* ennemyOrders, int nbEnnemyOrders) const {
+      // move
+      ++s.m_turn;
+      for (int i = 0; i < getNbFactories(); ++i)
+         s.m_troops[i].shift();
+      for (int i = 0; i < s.m_nbBombs; ++i)
+         --s.m_bombs[i].m_remainingTurns;
+      // orders
+      for (int i = 0; i < nbAllyOrders; ++i)
+         applyOrder(s, Faction::Ally, allyOrders[i]);
+      for (int i = 0; i < nbEnnemyOrders; ++i)
+         applyOrder(s, Faction::Ennemy, ennemyOrders[i]);
+      // production
+      for (int i = 0; i < getNbFactories(); ++i) {
+         Factory& f = s.m_factories[i];
+         if (f.m_disabledTurns > 0)
+            --f.m_disabledTurns;
+         else if (!f.isNeutral())
+            f.m_nbCyborgs += f.m_prodFactor;
+      }
+      // battles
+      for (int i = 0; i < getNbFactories(); ++i) {
+         int nbAttackers;
+         auto attacker = s.m_troops[i].land(nbAttackers);
+         if (nbAttackers > 0)
+            s.m_factories[i].solveBattle(attacker, nbAttackers);
+      }
+      // bombs
+      for (int i = 0; i < s.m_nbBombs; ) {
+         Bomb& b = s.m_bombs[i];
+         if (b.m_remainingTurns > 0) {
+            ++i;
+            continue;
+         }
+         Factory& f = s.m_factories[b.m_dstId];
+         f.m_nbCyborgs -= std::min(f.m_nbCyborgs, std::max(BOMB_MIN_DESTROYED, f.m_nbCyborgs / 2));
+         f.m_disabledTurns = BOMB_DISABLED_TURNS;
+         b = s.m_bombs[--s.m_nbBombs];
+      }
+   }
+   // Cheap opponent model: INC when safe, else send the surplus to the most profitable reachable target.
+   int playGreedy(const SimState& s, Faction::Type faction, Action::Order* orders) const {
+      int nbOrders = 0;
+      auto other = faction == Faction::Ally ? Faction::Ennemy : Faction::Ally;
+      for (int i = 0; i < getNbFactories(); ++i) {
+         const Factory& src = s.m_factories[i];
+         if (src.m_faction != faction)
+            continue;
+         int threat = s.m_troops[i].m_nbCyborgs[other] - s.m_troops[i].m_nbCyborgs[faction];
+         int available = src.m_nbCyborgs - std::max(0, threat);
+         if (available <= 0)
+            continue;
+         if (src.m_prodFactor < PROD_FACTOR_MAX && available >= static_cast<int>(UPGRADE_COST) + PROD_FACTOR_MAX) {
+            orders[nbOrders++] = Action::Order(Action::IncrementProd, i);
+            continue;
+         }
+         int targetId = -1;
+         int targetNeed = 0;
+         double bestScore = 0;
+         for (int j = 0; j < getNbFactories(); ++j) {
+            const Factory& dst = s.m_factories[j];
+            if (dst.m_faction == faction)
+               continue;
+            int d = getDistance(i, j);
+            int need = 1 + dst.m_nbCyborgs + (dst.m_faction == other ? dst.m_prodFactor * d : 0);
+            if (need > available)
+               continue;
+            double score = (0.5 + dst.m_prodFactor) / (d * need);
+            if (score > bestScore) {
+               bestScore = score;
+               targetId = j;
+               targetNeed = need;
+            }
+         }
+         if (targetId != -1)
+            orders[nbOrders++] = Action::Order(Action::Move, i, targetId, targetNeed);
+      }
+      return nbOrders;
+   }
+   bool isOver(const SimState& s) const {
+      int units[2] = { 0, 0 };
+      for (int i = 0; i < getNbFactories(); ++i) {
+         const Factory& f = s.m_factories[i];
+         if (!f.isNeutral())
+            units[SimState::side(f.m_faction)] += 1 + f.m_nbCyborgs;
+         units[0] += s.m_troops[i].m_nbCyborgs[Faction::Ally];
+         units[1] += s.m_troops[i].m_nbCyborgs[Faction::Ennemy];
+      }
+      return units[0] == 0 || units[1] == 0;
+   }
+   // Material balance from the point of view of faction: cyborgs plus weighted production.
+   int evaluate(const SimState& s, Faction::Type faction, int prodWeight = 10) const {
+      int score = 0;
+      for (int i = 0; i < getNbFactories(); ++i) {
+         const Factory& f = s.m_factories[i];
+         int value = f.m_nbCyborgs + prodWeight * f.m_prodFactor;
+         if (f.m_faction == faction)
+            score += value;
+         else if (!f.isNeutral())
+            score -= value;
+         score += s.m_troops[i].m_nbCyborgs[faction] - s.m_troops[i].m_nbCyborgs[faction == Faction::Ally ? Faction::Ennemy : Faction::Ally];
+      }
+      return score;
+   }
+   int getNbFactories() const { return m_kb.getNbFactories(); }
+   int getDistance(int srcId, int dstId) const { return m_kb.getLinkDistance(srcId, dstId); }
+
+private:
+   void applyOrder(SimState& s, Faction::Type faction, const Action::Order& o) const {
+      if (o.m_srcId < 0 || o.m_srcId >= getNbFactories())
+         return;
+      Factory& src = s.m_factories[o.m_srcId];
+      if (src.m_faction != faction)
+         return;
+      if (o.m_type == Action::Move) {
+         if (o.m_dstId == o.m_srcId || o.m_dstId < 0 || o.m_dstId >= getNbFactories())
+            return;
+         int n = std::min(o.m_nbCyborgs, src.m_nbCyborgs);
+         if (n <= 0)
+            return;
+         src.m_nbCyborgs -= n;
+         s.m_troops[o.m_dstId].add(faction, n, getDistance(o.m_srcId, o.m_dstId));
+      }
+      else if (o.m_type == Action::Bomb) {
+         int& available = s.m_availableBombs[SimState::side(faction)];
+         if (available == 0 || o.m_dstId == o.m_srcId || o.m_dstId < 0 || o.m_dstId >= getNbFactories())
+            return;
+         --available;
+         s.m_bombs[s.m_nbBombs++] = Bomb(faction, o.m_srcId, o.m_dstId, getDistance(o.m_srcId, o.m_dstId));
+      }
+      else if (o.m_type == Action::IncrementProd) {
+         if (src.m_prodFactor < PROD_FACTOR_MAX && src.m_nbCyborgs >= static_cast<int>(UPGRADE_COST)) {
+            src.m_nbCyborgs -= UPGRADE_COST;
+            ++src.m_prodFactor;
+         }
+      }
+   }
+
+   const Knowledge& m_kb;
 };
 
 struct IStrategy {
+   virtual ~IStrategy() {}
+   // Called as soon as the input of the turn is available, before parsing.
+   virtual void beginTurn() {}
    virtual void operator()() = 0;
 };
 
+// Weights of BestProdStrategy, read at run time so that they can be tuned
+// offline; the defaults are the hand tuned values played in the arena.
+struct BestProdParams {
+   enum Index {
+      Distance,
+      Prod,
+      Ennemy,
+      BombTrigger,
+      UpgradeThreshold,
+      NB_PARAMS
+   };
+   static const char* getName(int i) {
+      static const char* const NAMES[NB_PARAMS] = { "W_DISTANCE", "W_PROD", "W_ENNEMY", "W_BOMB_TRIGGER", "UPGRADE_THRESHOLD" };
+      return NAMES[i];
+   }
+   BestProdParams() {
+      m_values[Distance] = W_DISTANCE;
+      m_values[Prod] = W_PROD;
+      m_values[Ennemy] = W_ENNEMY;
+      m_values[BombTrigger] = W_BOMB_TRIGGER;
+      m_values[UpgradeThreshold] = UPGRADE_COST; // discounted cyborgs needed to INC
+   }
+   double operator[](int i) const { return m_values[i]; }
+   double& operator[](int i) { return m_values[i]; }
+
+   double m_values[NB_PARAMS];
+};
+
 struct BestProdStrategy : public IStrategy {
-   BestProdStrategy(const Knowledge& kb, Action& action)
-      : m_kb(kb), m_action(action), m_step(0) {}
+   // scores of the turn, allocated from the arena of the turn
+   typedef ArenaVector<std::pair<int, double> > T_Scores;
+
+   BestProdStrategy(const Knowledge& kb, Action& action, Arena& arena, const BestProdParams& params = BestProdParams())
+      : m_kb(kb), m_action(action), m_arena(arena), m_params(params), m_step(0) {}
    virtual void operator()() override {
       ++m_step;
-      Knowledge& localKb = m_kb.getLocalKnowledge();
-      auto allies = getFactories([](const Factory& f) { return f.isAlly(); });
-
-      std::set<int> excludedTarget;
-
-      // INC BEHAVIOR
-      {
-         auto alliesSortedBySafety = allies;
-         std::sort(alliesSortedBySafety.begin(), alliesSortedBySafety.end(),
-            [&](const Factory& a, const Factory& b) { return findClosestFactoryId(a.m_id, Faction::Ennemy) >= findClosestFactoryId(b.m_id, Faction::Ennemy); });
-         for (auto& ally : alliesSortedBySafety) {
-            auto nbCb = getDiscountedNbCyborgs(ally.m_id, Faction::Ally);
-            if (ally.m_nbCyborgs >= UPGRADE_COST && nbCb >= UPGRADE_COST) {
-               m_action.pushOrder(Action::Order(Action::IncrementProd, ally.m_id));
-               ally.m_nbCyborgs -= UPGRADE_COST;
-            }
-         }
+      playIncrementProd();
+      playBomb();
+      playAttack();
+      playSupport();
+   }
+   // *********** PHASES *********** //
+   void playIncrementProd() {
+      const KnowledgeState& localKb = m_kb.getLocalKnowledge();
+      const FactionIndex& factions = m_kb.getFactions();
+      const int nbAllies = factions.getSize(Faction::Ally);
+      assert(nbAllies <= static_cast<int>(NB_FACTORY_MAX));
+      std::array<int, NB_FACTORY_MAX> alliesSortedBySafety;
+      std::copy(factions.getIds(Faction::Ally), factions.getIds(Faction::Ally) + nbAllies, alliesSortedBySafety.begin());
+      std::sort(alliesSortedBySafety.begin(), alliesSortedBySafety.begin() + nbAllies,
+         [&](int a, int b) { return factions.getClosest(a, Faction::Ennemy) > factions.getClosest(b, Faction::Ennemy); });
+      for (int i = 0; i < nbAllies; ++i) {
+         auto allyId = alliesSortedBySafety[i];
+         auto nbCb = getDiscountedNbCyborgs(allyId, Faction::Ally);
+         // nbCb < 0 (the factory falls anyway) passed the former unsigned test: upgrading is better than losing the cyborgs
+         if (localKb.m_factories[allyId].m_nbCyborgs >= static_cast<int>(UPGRADE_COST) && (nbCb < 0 || nbCb >= m_params[BestProdParams::UpgradeThreshold]))
+            m_action.pushOrder(Action::Order(Action::IncrementProd, allyId));
       }
-      // BOMB BEHAVIOR
-      if (localKb.hasAvailableBomb()) {
-         int targetId = getBombId();
-         if (targetId != -1 && !localKb.isAlreadyTargeted(targetId)) {
-            auto srcId = findClosestFactoryId(targetId, Faction::Ally);
-            if (srcId != -1) {
-               m_action.pushOrder(Action::Order(Action::Bomb, srcId, targetId));
-               --localKb.m_availableBombs;
-               localKb.m_bombTargetId[localKb.m_availableBombs - 1] = targetId;
-            }
+   }
+   void playBomb() {
+      KnowledgeState& localKb = m_kb.getLocalKnowledge();
+      if (!localKb.hasAvailableBomb())
+         return;
+      int targetId = getBombId();
+      if (targetId != -1 && !localKb.isAlreadyTargeted(targetId)) {
+         auto srcId = m_kb.getFactions().getClosest(targetId, Faction::Ally);
+         if (srcId != -1 && m_action.pushOrder(Action::Order(Action::Bomb, srcId, targetId))) {
+            --localKb.m_availableBombs;
+            localKb.m_bombTargetId[localKb.m_availableBombs] = targetId;
          }
       }
-      // MOVE ATTACK BEHAVIOR
-      {
-         auto scores = getDecisionAttackScores();
-         if (!scores.empty()) {
-            for (auto& s : scores) {
-               auto& targetId = s.first;
-               LOG("+ look to colonize " << targetId);
-               auto nbEnnemies = std::max(getNbCyborgs(targetId, Faction::Ennemy), getNbCyborgs(targetId, Faction::Neutral));
-               auto nbAllies = getNbCyborgs(targetId, Faction::Ally);
-               auto targetProdFactor = localKb.m_factories[targetId].m_prodFactor;
-               if (nbAllies <= nbEnnemies + targetProdFactor) {
-                  int nbCyborgsToSent = 1 + targetProdFactor + (nbEnnemies - nbAllies);
-                  std::sort(allies.begin(), allies.end(), [&](const Factory& a, const Factory& b) { return localKb.m_safeDistances[targetId][a.m_id].first < localKb.m_safeDistances[targetId][b.m_id].first; });
-                  for (auto& ally : allies) {
-                     bool isBombed = localKb.isAlreadyTargeted(ally.m_id);
-                     auto nbCyborgsAvailable = ally.m_nbCyborgs - getNbCyborgs(ally.m_id, Faction::Ennemy) + getNbCyborgs(ally.m_id, Faction::Ally); // TODO TODO: remove the one coming from ennemy and add ally
-                     auto pathToGoTo = localKb.getNextStepToGoTo(ally.m_id, targetId);
-                     if (isBombed) {
-                        auto v = ally.m_nbCyborgs;
-                        m_action.pushOrder(Action::Order(Action::Move, ally.m_id, pathToGoTo, v));
-                        ally.m_nbCyborgs -= v;
-                        nbCyborgsToSent -= v;
-                     }
-                     else if (nbCyborgsAvailable > 0 && pathToGoTo == targetId) {
-                        auto v = ally.m_nbCyborgs;
-                        m_action.pushOrder(Action::Order(Action::Move, ally.m_id, pathToGoTo, v));
-                        ally.m_nbCyborgs -= v;
-                        nbCyborgsToSent -= v;
-                     }
-                     if (nbCyborgsToSent < 0)
-                        break;
-                  }
-               }
+   }
+   void playAttack() {
+      const KnowledgeState& localKb = m_kb.getLocalKnowledge();
+      const FactionIndex& factions = m_kb.getFactions();
+      const int nbAllies = factions.getSize(Faction::Ally);
+      assert(nbAllies <= static_cast<int>(NB_FACTORY_MAX));
+      std::array<int, NB_FACTORY_MAX> allies;
+      std::copy(factions.getIds(Faction::Ally), factions.getIds(Faction::Ally) + nbAllies, allies.begin());
+      // cyborgs left in each ally factory once this turn's attacks are sent
+      int allyCyborgs[NB_FACTORY_MAX];
+      for (int i = 0; i < nbAllies; ++i)
+         allyCyborgs[allies[i]] = localKb.m_factories[allies[i]].m_nbCyborgs;
+      auto scores = getDecisionAttackScores();
+      for (auto& s : scores) {
+         auto& targetId = s.first;
+         LOG_DEBUG("+ look to colonize {}", targetId);
+         auto closestAllyId = factions.getClosest(targetId, Faction::Ally);
+         if (closestAllyId == -1)
+            continue;
+         // garrison met by the first cyborgs we could send, troops in flight included
+         auto eta = m_kb.getSafeDistance(closestAllyId, targetId);
+         auto projected = localKb.m_troops[targetId].projectedGarrison(localKb.m_factories[targetId], eta);
+         if (projected.isAlly())
+            continue;
+         int nbCyborgsToSent = 1 + projected.m_nbCyborgs;
+         std::sort(allies.begin(), allies.begin() + nbAllies, [&](int a, int b) { return m_kb.getSafeDistance(targetId, a) < m_kb.getSafeDistance(targetId, b); });
+         for (int i = 0; i < nbAllies; ++i) {
+            auto allyId = allies[i];
+            bool isBombed = localKb.isAlreadyTargeted(allyId);
+            auto nbCyborgsAvailable = allyCyborgs[allyId] - getNbCyborgs(allyId, Faction::Ennemy) + getNbCyborgs(allyId, Faction::Ally); // TODO TODO: remove the one coming from ennemy and add ally
+            auto pathToGoTo = m_kb.getNextStepToGoTo(allyId, targetId);
+            if (isBombed || (nbCyborgsAvailable > 0 && pathToGoTo == targetId)) {
+               auto v = allyCyborgs[allyId];
+               m_action.pushOrder(Action::Order(Action::Move, allyId, pathToGoTo, v));
+               allyCyborgs[allyId] -= v;
+               nbCyborgsToSent -= v;
             }
+            if (nbCyborgsToSent < 0)
+               break;
          }
       }
-      // MOVE SUPPORT BEHAVIOR
-      // Scoring From: 
-      //  discount cbg           >
-      //  distance to ennemy     >
-      //  nb prod                <
-      // Scoring To:
-      //  reverse(From)
-      if (true) {
-         auto scores = getDecisionSupportScores();
-         if (!scores.empty()) {
-            auto first = 0;
-            auto last = scores.size() - 1;
-            auto mid = scores.size();
-            while (first < last && mid > 0) {
-               auto srcId = scores[first].first;
-               auto targetId = scores[last].first;
-               auto pathToGoTo = localKb.getNextStepToGoTo(srcId, targetId);
-               if (localKb.m_factories[srcId].m_prodFactor == 3) {
-                  LOG("- cover " << pathToGoTo << " from " << srcId);
-                  auto& v = localKb.m_factories[srcId].m_nbCyborgs;
-                  m_action.pushOrder(Action::Order(Action::Move, srcId, pathToGoTo, v));
-                  localKb.m_factories[srcId].m_nbCyborgs = 0;
-               }
-               ++first;
-               --last;
-               mid /= 2;
-            }
+   }
+   // Scoring From: 
+   //  discount cbg           >
+   //  distance to ennemy     >
+   //  nb prod                <
+   // Scoring To:
+   //  reverse(From)
+   void playSupport() {
+      KnowledgeState& localKb = m_kb.getLocalKnowledge();
+      auto scores = getDecisionSupportScores();
+      if (scores.empty())
+         return;
+      int first = 0;
+      int last = static_cast<int>(scores.size()) - 1;
+      auto mid = scores.size();
+      while (first < last && mid > 0) {
+         auto srcId = scores[first].first;
+         auto targetId = scores[last].first;
+         auto pathToGoTo = m_kb.getNextStepToGoTo(srcId, targetId);
+         if (localKb.m_factories[srcId].m_prodFactor == 3) {
+            LOG_DEBUG("- cover {} from {}", pathToGoTo, srcId);
+            auto& v = localKb.m_factories[srcId].m_nbCyborgs;
+            m_action.pushOrder(Action::Order(Action::Move, srcId, pathToGoTo, v));
+            localKb.m_factories[srcId].m_nbCyborgs = 0;
          }
+         ++first;
+         --last;
+         mid /= 2;
       }
    }
    // *********** UTILITIES *********** //
    int getDiscountedNbCyborgs(int targetId, Faction::Type faction) const {
-      Knowledge& localKb = m_kb.getLocalKnowledge();
-      auto res = m_kb.m_factories[targetId].m_nbCyborgs + getNbCyborgs(targetId, faction);
+      auto res = m_kb.getState().m_factories[targetId].m_nbCyborgs + getNbCyborgs(targetId, faction);
       res -= getNbCyborgs(targetId, faction == Faction::Ally ? Faction::Ennemy : Faction::Ally);
       return res;
    }
    int getNbCyborgs(int targetId, Faction::Type faction) const {
-      Knowledge& localKb = m_kb.getLocalKnowledge();
+      const KnowledgeState& localKb = m_kb.getLocalKnowledge();
       int res = localKb.m_troops[targetId].m_nbCyborgs[faction];
       if (localKb.m_factories[targetId].m_faction == faction)
          res = localKb.m_factories[targetId].m_nbCyborgs;
       return res;
    }
-   template<typename Predicate>
-   std::vector<Factory> getFactories(Predicate p) const {
-      std::vector<Factory> res;
-      const Knowledge& localKb = m_kb.getLocalKnowledge();
-      std::copy_if(localKb.m_factories.begin(), localKb.m_factories.end(), std::back_inserter(res), p);
-      return res;
-   }
-   int findClosestFactoryId(int targetId, Faction::Type faction) const {
-      const Knowledge& localKb = m_kb.getLocalKnowledge();
-      const auto& distancesFromTarget = localKb.m_distances[targetId];
-      auto allies = getFactories([&](const Factory& f) { return f.m_faction == faction; });
-      auto id = -1;
-      auto minD = std::numeric_limits<double>::max();
-      for (auto& ally : allies) {
-         auto d = distancesFromTarget[ally.m_id];
-         if (d <= minD) {
-            minD = d;
-            id = ally.m_id;
-         }
-      }
-      return id;
-   }
    int getBombId() const {
-      const Knowledge& localKb = m_kb.getLocalKnowledge();
+      const KnowledgeState& localKb = m_kb.getLocalKnowledge();
+      const FactionIndex& factions = m_kb.getFactions();
 
-      auto ennemies = getFactories([](const Factory& f) { return f.isEnnemy(); });
-      auto allies = getFactories([](const Factory& f) { return f.isAlly(); });
+      const int* ennemies = factions.getIds(Faction::Ennemy);
+      const int* allies = factions.getIds(Faction::Ally);
+      auto nbEnnemies = factions.getSize(Faction::Ennemy);
+      auto nbAllies = factions.getSize(Faction::Ally);
       auto maxEnnemyCbg = 0;
       auto maxAllyCbg = 0;
       auto ennemyId = 0;
-      for (auto& ally : allies)
-         maxAllyCbg = std::max(maxAllyCbg, ally.m_nbCyborgs);
-      for (auto& ennemy : ennemies) {
-         auto futureNbCyborg = getDiscountedNbCyborgs(ennemy.m_id, Faction::Ennemy);
+      for (int i = 0; i < nbAllies; ++i)
+         maxAllyCbg = std::max(maxAllyCbg, localKb.m_factories[allies[i]].m_nbCyborgs);
+      for (int i = 0; i < nbEnnemies; ++i) {
+         auto futureNbCyborg = getDiscountedNbCyborgs(ennemies[i], Faction::Ennemy);
          if (maxEnnemyCbg <= futureNbCyborg) {
             maxEnnemyCbg = futureNbCyborg;
-            ennemyId = ennemy.m_id;
+            ennemyId = ennemies[i];
          }
       }
-      LOG("-> score to bomb #" << localKb.m_availableBombs << " on " << ennemyId << " " << maxAllyCbg << " : " << maxEnnemyCbg);
-      if (ennemies.size() == 1 && allies.size() == 1 && localKb.m_availableBombs == 2)
+      LOG_DEBUG("-> score to bomb #{} on {} {} : {}", localKb.m_availableBombs, ennemyId, maxAllyCbg, maxEnnemyCbg);
+      if (nbEnnemies == 1 && nbAllies == 1 && localKb.m_availableBombs == 2)
          return ennemyId;
-      if (maxEnnemyCbg > W_BOMB_TRIGGER * maxAllyCbg)
+      if (maxEnnemyCbg > m_params[BestProdParams::BombTrigger] * maxAllyCbg)
          return ennemyId;
       return -1;
    }
    double getMeanDistanceFromFaction(int srcId, Faction::Type faction) const {
-      const Knowledge& localKb = m_kb.getLocalKnowledge();
-      auto targets = getFactories([&](const Factory& f) { return faction == f.m_faction; });
-      if (targets.empty())
+      const FactionIndex& factions = m_kb.getFactions();
+      auto nbTargets = factions.getSize(faction);
+      if (nbTargets == 0)
          return 10;
+      const int* targets = factions.getIds(faction);
       double distance = 0;
-      for (auto& f : targets) {
-         distance += localKb.m_safeDistances[srcId][f.m_id].first;
+      for (int i = 0; i < nbTargets; ++i) {
+         distance += m_kb.getSafeDistance(srcId, targets[i]);
       }
-      return distance / targets.size();
+      return distance / nbTargets;
    }
-private:
    // *********** ATTACK DECISION *********** //
-   std::vector<std::pair<int, double> > getDecisionAttackScores() const {
-      auto allies = getFactories([](const Factory& f) { return f.isAlly(); });
-      auto others = getFactories([](const Factory& f) { return !f.isAlly(); });
-      LOG("+ computing attack scores...");
-      std::vector<std::pair<int, double> > scores;
-      for (auto& target : others) {
-         scores.push_back(std::make_pair(target.m_id, computeAttackValue(target, allies)));
-      }
-      std::sort(scores.begin(), scores.end(), [&](const std::pair<int, double>& a, const std::pair<int, double>& b) { return a.second >= b.second; });
+   T_Scores getDecisionAttackScores() const {
+      const FactionIndex& factions = m_kb.getFactions();
+      // neutral and ennemy factories, in id order
+      int others[NB_FACTORY_MAX];
+      auto nbOthers = std::merge(factions.getIds(Faction::Neutral), factions.getIds(Faction::Neutral) + factions.getSize(Faction::Neutral),
+         factions.getIds(Faction::Ennemy), factions.getIds(Faction::Ennemy) + factions.getSize(Faction::Ennemy), others) - others;
+      LOG_DEBUG("+ computing attack scores...");
+      T_Scores scores((ArenaAllocator<std::pair<int, double> >(m_arena)));
+      scores.reserve(nbOthers);
+      for (int i = 0; i < nbOthers; ++i) {
+         scores.push_back(std::make_pair(others[i], computeAttackValue(m_kb.getLocalKnowledge().m_factories[others[i]])));
+      }
+      std::sort(scores.begin(), scores.end(), byDecreasingScore);
       return scores;
    }
-   double computeAttackValue(const Factory& target, const T_Factories& allies) const {
-      const Knowledge& localKb = m_kb.getLocalKnowledge();
-      const auto& distancesFromTarget = localKb.m_distances[target.m_id];
+   double computeAttackValue(const Factory& target) const {
+      const KnowledgeState& localKb = m_kb.getLocalKnowledge();
+      const FactionIndex& factions = m_kb.getFactions();
+      const auto* distancesFromTarget = m_kb.getDistances(target.m_id);
+      const int* allies = factions.getIds(Faction::Ally);
+      auto nbAllies = factions.getSize(Faction::Ally);
       double bombFactor = localKb.isAlreadyTargeted(target.m_id) ? 0 : 1;
-      double factionScore = target.isEnnemy() ? W_ENNEMY : 1;
-      double prodScore = 0.25 + W_PROD * target.m_prodFactor;
+      double factionScore = target.isEnnemy() ? m_params[BestProdParams::Ennemy] : 1;
+      double prodScore = 0.25 + m_params[BestProdParams::Prod] * target.m_prodFactor;
       double distanceScore = 0;
-      for (auto& ally : allies) {
-         auto d = distancesFromTarget[ally.m_id];
-         distanceScore += W_DISTANCE / d;
+      for (int i = 0; i < nbAllies; ++i) {
+         auto d = distancesFromTarget[allies[i]];
+         distanceScore += m_params[BestProdParams::Distance] / d;
       }
-      if (!allies.empty())
-         distanceScore /= allies.size();
+      if (nbAllies != 0)
+         distanceScore /= nbAllies;
       auto score = bombFactor* factionScore * prodScore * distanceScore;
-      LOG("-> score to attack #" << target.m_id << " (" << bombFactor << " # " << factionScore << " # " << prodScore << " # " << distanceScore << ") --> " << score);
+      LOG_DEBUG("-> score to attack #{} ({} # {} # {} # {}) --> {}", target.m_id, bombFactor, factionScore, prodScore, distanceScore, score);
       return score;
    }
    // *********** SUPPORT DECISION *********** //
-   std::vector<std::pair<int, double> > getDecisionSupportScores() const {
-      auto allies = getFactories([](const Factory& f) { return f.isAlly(); });
-      auto ennemies = getFactories([](const Factory& f) { return !f.isAlly(); });
-      LOG("+ computing support scores...");
-      std::vector<std::pair<int, double> > scores;
-      for (auto& ally : allies) {
-         scores.push_back(std::make_pair(ally.m_id, computeSupportValue(ally, ennemies)));
-      }
-      std::sort(scores.begin(), scores.end(), [&](const std::pair<int, double>& a, const std::pair<int, double>& b) { return a.second >= b.second; });
+   T_Scores getDecisionSupportScores() const {
+      const FactionIndex& factions = m_kb.getFactions();
+      const int* allies = factions.getIds(Faction::Ally);
+      LOG_DEBUG("+ computing support scores...");
+      T_Scores scores((ArenaAllocator<std::pair<int, double> >(m_arena)));
+      scores.reserve(factions.getSize(Faction::Ally));
+      for (int i = 0; i < factions.getSize(Faction::Ally); ++i) {
+         scores.push_back(std::make_pair(allies[i], computeSupportValue(m_kb.getLocalKnowledge().m_factories[allies[i]])));
+      }
+      std::sort(scores.begin(), scores.end(), byDecreasingScore);
       return scores;
    }
-   double computeSupportValue(const Factory& src, const T_Factories& ennemies) const {
-      const Knowledge& localKb = m_kb.getLocalKnowledge();
-
-      double prodScore = 0.1 + 5 * src.m_prodFactor / W_PROD;
+   double computeSupportValue(const Factory& src) const {
+      double prodScore = 0.1 + 5 * src.m_prodFactor / m_params[BestProdParams::Prod];
       double distanceToEnnemies = getMeanDistanceFromFaction(src.m_id, Faction::Ennemy);
-      double discountedCbg = 1 + 10 * (static_cast<double>(getDiscountedNbCyborgs(src.m_id, Faction::Ally)) / std::max(1, m_kb.m_nbTotalCyborgs));
+      double discountedCbg = 1 + 10 * (static_cast<double>(getDiscountedNbCyborgs(src.m_id, Faction::Ally)) / std::max(1, m_kb.getState().m_nbTotalCyborgs));
       auto score = prodScore * distanceToEnnemies * discountedCbg;
-      LOG("-> score to support #" << src.m_id << " (" << " # " << prodScore << " # " << distanceToEnnemies << " # " << discountedCbg << ") --> " << score);
+      LOG_DEBUG("-> score to support #{} ( # {} # {} # {}) --> {}", src.m_id, prodScore, distanceToEnnemies, discountedCbg, score);
       return score;
    }
 
+private:
+   // ties by decreasing id, as the former '>=' comparator did on arena sized maps
+   static bool byDecreasingScore(const std::pair<int, double>& a, const std::pair<int, double>& b) {
+      return a.second > b.second || (a.second == b.second && a.first > b.first);
+   }
+
    const Knowledge& m_kb;
    Action& m_action;
+   Arena& m_arena;
+   BestProdParams m_params;
    int m_step;
 };
 
+// Candidate order set for the current turn.
+struct Plan {
+   Plan() : m_nbOrders(0), m_score(std::numeric_limits<int>::min()) {}
+   void push(const Action::Order& o) { if (m_nbOrders < SIM_MAX_ORDERS) m_orders[m_nbOrders++] = o; }
+   void removeFrom(int srcId) {
+      int n = 0;
+      for (int i = 0; i < m_nbOrders; ++i)
+         if (m_orders[i].m_srcId != srcId)
+            m_orders[n++] = m_orders[i];
+      m_nbOrders = n;
+   }
+   Action::Order m_orders[SIM_MAX_ORDERS];
+   int m_nbOrders;
+   int m_score;
+};
+
+// Generates and rolls out plans from a private copy of the current turn:
+// the plan is played on the first turn, then both sides follow the greedy
+// model for SEARCH_HORIZON turns. Owns its RNG so that one evaluator per
+// thread can run without sharing anything but the read-only topology.
+struct RolloutEvaluator {
+   RolloutEvaluator(const Knowledge& kb, std::uint32_t seed)
+      : m_kb(kb), m_sim(kb), m_rng(seed ? seed : 1), m_nbRollouts(0) {}
+
+   void load() { m_sim.load(m_root); }
+   void load(const SimState& root) { m_root = root; }
+   const SimState& getRoot() const { return m_root; }
+   // noisy rollouts randomly drop opponent orders, to sample around the greedy model
+   int evaluate(const Plan& plan, bool noisy = false) {
+      SimState s = m_root;
+      Action::Order allyOrders[SIM_MAX_ORDERS];
+      Action::Order ennemyOrders[SIM_MAX_ORDERS];
+      int nbEnnemyOrders = playEnnemy(s, ennemyOrders, noisy);
+      m_sim.step(s, plan.m_orders, plan.m_nbOrders, ennemyOrders, nbEnnemyOrders);
+      for (int t = 1; t < SEARCH_HORIZON && !m_sim.isOver(s); ++t) {
+         int nbAllyOrders = m_sim.playGreedy(s, Faction::Ally, allyOrders);
+         nbEnnemyOrders = playEnnemy(s, ennemyOrders, noisy);
+         m_sim.step(s, allyOrders, nbAllyOrders, ennemyOrders, nbEnnemyOrders);
+      }
+      ++m_nbRollouts;
+      return m_sim.evaluate(s, Faction::Ally);
+   }
+   void greedyPlan(Plan& plan) const {
+      plan.m_nbOrders = m_sim.playGreedy(m_root, Faction::Ally, plan.m_orders);
+   }
+   void randomPlan(Plan& plan) {
+      plan.m_nbOrders = 0;
+      for (int i = 0; i < m_sim.getNbFactories(); ++i)
+         if (m_root.m_factories[i].isAlly())
+            randomOrders(plan, i);
+      const KnowledgeState& localKb = m_kb.getLocalKnowledge();
+      if (localKb.hasAvailableBomb() && nextRandom() % 8 == 0) {
+         auto targetId = static_cast<int>(nextRandom() % m_sim.getNbFactories());
+         if (m_root.m_factories[targetId].isEnnemy() && !localKb.isAlreadyTargeted(targetId)) {
+            auto srcId = -1;
+            for (int i = 0; i < m_sim.getNbFactories(); ++i)
+               if (m_root.m_factories[i].isAlly() && (srcId == -1 || m_sim.getDistance(i, targetId) < m_sim.getDistance(srcId, targetId)))
+                  srcId = i;
+            if (srcId != -1)
+               plan.push(Action::Order(Action::Bomb, srcId, targetId));
+         }
+      }
+   }
+   void mutate(const Plan& from, Plan& plan) {
+      plan = from;
+      int allies[NB_FACTORY_MAX];
+      int nbAllies = 0;
+      for (int i = 0; i < m_sim.getNbFactories(); ++i)
+         if (m_root.m_factories[i].isAlly())
+            allies[nbAllies++] = i;
+      if (nbAllies == 0)
+         return;
+      auto srcId = allies[nextRandom() % nbAllies];
+      plan.removeFrom(srcId);
+      randomOrders(plan, srcId);
+   }
+   std::uint32_t nextRandom() {
+      // xorshift32
+      m_rng ^= m_rng << 13;
+      m_rng ^= m_rng >> 17;
+      m_rng ^= m_rng << 5;
+      return m_rng;
+   }
+   int getNbRollouts() const { return m_nbRollouts; }
+   void resetNbRollouts() { m_nbRollouts = 0; }
+
+private:
+   int playEnnemy(const SimState& s, Action::Order* orders, bool noisy) {
+      int nbOrders = m_sim.playGreedy(s, Faction::Ennemy, orders);
+      if (!noisy)
+         return nbOrders;
+      int n = 0;
+      for (int i = 0; i < nbOrders; ++i)
+         if (nextRandom() % 4 != 0)
+            orders[n++] = orders[i];
+      return n;
+   }
+   void randomOrders(Plan& plan, int srcId) {
+      const Factory& src = m_root.m_factories[srcId];
+      auto n = m_sim.getNbFactories();
+      switch (nextRandom() % 4) {
+      case 0:
+         break;
+      case 1:
+         if (src.m_prodFactor < PROD_FACTOR_MAX && src.m_nbCyborgs >= static_cast<int>(UPGRADE_COST)) {
+            plan.push(Action::Order(Action::IncrementProd, srcId));
+            break;
+         }
+         [[fallthrough]];
+      default:
+      {
+         auto dstId = static_cast<int>(nextRandom() % n);
+         auto nbCyborgs = (nextRandom() & 1) ? src.m_nbCyborgs : src.m_nbCyborgs / 2;
+         if (dstId != srcId && nbCyborgs > 0)
+            plan.push(Action::Order(Action::Move, srcId, dstId, nbCyborgs));
+      }
+      }
+   }
+
+   const Knowledge& m_kb;
+   Simulator m_sim;
+   SimState m_root;
+   std::uint32_t m_rng;
+   int m_nbRollouts;
+};
+
+// Anytime search: random and mutated plans for the current turn are rolled
+// out until the turn deadline, and the best plan found so far is played.
+struct SearchStrategy : public IStrategy {
+   struct Deadline {
+      typedef std::chrono::steady_clock Clock;
+      static Clock::duration fromMs(double ms) { return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(ms)); }
+      explicit Deadline(double budgetMs) : m_end(Clock::now() + fromMs(budgetMs)) {}
+      // true while another task of the given duration still fits before the deadline
+      bool allows(Clock::duration taskDuration) const { return Clock::now() + taskDuration < m_end; }
+      Clock::time_point m_end;
+   };
+
+   SearchStrategy(const Knowledge& kb, Action& action, double budgetMs = SEARCH_BUDGET_MS, std::uint32_t seed = 0x9e3779b9u)
+      : m_kb(kb), m_action(action), m_eval(kb, seed), m_budgetMs(budgetMs), m_deadline(budgetMs) {}
+   // The budget counts from here, parsing included.
+   virtual void beginTurn() override { m_deadline = Deadline(m_budgetMs); }
+   virtual void operator()() override {
+      // Rollouts vary with the plan, and the next one may be slower than
+      // any seen so far: one is only started while twice the worst of them
+      // plus a margin is left. This is a heuristic, not a bound: the 10ms
+      // between SEARCH_BUDGET_MS and TURN_TIMEOUT_MS absorb the rest.
+      const Deadline::Clock::duration margin = Deadline::fromMs(SEARCH_MARGIN_MS);
+      Deadline::Clock::duration worstRollout(0);
+      m_eval.load();
+      m_eval.resetNbRollouts();
+
+      // the greedy plan is played unscored if the margin is already gone
+      Plan greedy;
+      m_eval.greedyPlan(greedy);
+      Plan best = greedy;
+      bool isScored = false;
+      Plan candidate; // WAIT first, then the greedy plan, then the search
+      for (int i = 0; m_deadline.allows(2 * worstRollout + margin); ++i) {
+         auto start = Deadline::Clock::now();
+         if (i == 1)
+            candidate = greedy;
+         else if (i > 1 && (m_eval.nextRandom() & 1))
+            m_eval.randomPlan(candidate);
+         else if (i > 1)
+            m_eval.mutate(best, candidate);
+         candidate.m_score = m_eval.evaluate(candidate);
+         if (!isScored || candidate.m_score > best.m_score)
+            best = candidate;
+         isScored = true;
+         worstRollout = std::max(worstRollout, Deadline::Clock::now() - start);
+      }
+      LOG_INFO("+ search: {} rollouts, best {}", m_eval.getNbRollouts(), best.m_score);
+      play(best);
+   }
+   int getNbRollouts() const { return m_eval.getNbRollouts(); }
+
+private:
+   void play(const Plan& plan) {
+      KnowledgeState& localKb = m_kb.getLocalKnowledge();
+      for (int i = 0; i < plan.m_nbOrders; ++i) {
+         const Action::Order& o = plan.m_orders[i];
+         if (o.m_type == Action::Bomb) {
+            if (!localKb.hasAvailableBomb())
+               continue;
+            --localKb.m_availableBombs;
+            localKb.m_bombTargetId[localKb.m_availableBombs] = o.m_dstId;
+         }
+         m_action.pushOrder(o);
+      }
+   }
+
+   const Knowledge& m_kb;
+   Action& m_action;
+   RolloutEvaluator m_eval;
+   double m_budgetMs;
+   Deadline m_deadline;
+};
+
 struct Decision {
    enum Strategy {
       Random,
-      BestProd
+      BestProd,
+      Search
    };
-   Decision(const Knowledge& kb, Action& action, Strategy strategy = BestProd)
+   Decision(const Knowledge& kb, Action& action, Arena& arena, Strategy strategy = BestProd)
       : m_kb(kb), m_action(action), m_strategy()
    {
       switch (strategy) {
+      case Search:
+      {
+         m_strategy = std::unique_ptr<IStrategy>(new SearchStrategy(m_kb, m_action));
+         break;
+      }
       case Random:
       case BestProd:
       default:
       {
-         m_strategy = std::unique_ptr<IStrategy>(new BestProdStrategy(m_kb, m_action));
+         m_strategy = std::unique_ptr<IStrategy>(new BestProdStrategy(m_kb, m_action, arena));
          break;
       }
       }
    }
+   // Strategy named by name ("bestprod", "search", "random"), BestProd if unknown.
+   static Strategy fromName(const char* name) {
+      if (std::strcmp(name, "search") == 0)
+         return Search;
+      if (std::strcmp(name, "random") == 0)
+         return Random;
+      return BestProd;
+   }
+   // GITC_STRATEGY from the environment, else the one built in (-DGITC_STRATEGY=\"search\").
+   static Strategy getDefault() {
+      const char* name = std::getenv("GITC_STRATEGY");
+      return fromName(name != nullptr ? name : GITC_STRATEGY);
+   }
    void initialize() {}
    void terminate() {}
+   void beginTurn() { m_strategy->beginTurn(); }
    void step() {
-      LOG("======== step.decision ============");
+      LOG_DEBUG("======== step.decision ============");
       (*m_strategy)();
    }
 
@@ -577,9 +1341,12 @@ private:
    std::unique_ptr<IStrategy> m_strategy;
 };
 
+// Bytes of temporaries a turn may allocate, the strategy needs a few hundreds.
+static const std::size_t TURN_ARENA_SIZE = 1 << 16;
+
 struct Simulation {
-   Simulation()
-      : m_action(), m_kb(), m_dec(m_kb, m_action)
+   Simulation(io::Reader& in, io::Writer& out, Decision::Strategy strategy = Decision::getDefault())
+      : m_in(in), m_kb(in), m_action(out, m_kb), m_arena(TURN_ARENA_SIZE), m_dec(m_kb, m_action, m_arena, strategy)
    {
       m_action.initialize();
       m_kb.initialize();
@@ -590,26 +1357,48 @@ struct Simulation {
       m_kb.terminate();
       m_action.terminate();
    }
-   void step() {
-      LOG("======== step ============");
-      m_kb.step();
+   bool step() {
+      LOG_DEBUG("======== step ============");
+      if (m_in.eof()) // waits for the referee
+         return false;
+      m_profiler.beginTurn();
+      m_dec.beginTurn();
+      m_arena.reset(); // the temporaries of the previous turn are dead
+      if (!m_kb.step())
+         return false;
+      m_profiler.mark(TurnProfiler::Parse);
       m_dec.step();
+      m_profiler.mark(TurnProfiler::Decide);
       m_action.step();
+      m_profiler.mark(TurnProfiler::Emit);
+      m_profiler.endTurn();
+      logging::trace().flush();
+      return true;
    }
+   const TurnProfiler& getProfiler() const { return m_profiler; }
+   const Arena& getArena() const { return m_arena; }
 private:
-   Action m_action;
+   io::Reader& m_in;
+   TurnProfiler m_profiler;
    Knowledge m_kb;
+   Action m_action;
+   Arena m_arena;
    Decision m_dec;
 };
+#ifndef GITC_NO_MAIN
 /**
 * Auto-generated code below aims at helping you parse
 * the standard input according to the problem statement.
 **/
 int main()
 {
-   Simulation sim;
+   static io::Reader in;
+   static io::Writer out;
+   capture::startFromEnv(in, "ghost_in_the_cell");
+   Simulation sim(in, out);
    // game loop
-   while (1) {
-      sim.step();
+   while (sim.step()) {
    }
-}
\ No newline at end of file
+   sim.getProfiler().print(stderr);
+}
+#endif
@@ -0,0 +1,100 @@
+#ifndef GITC_MAP_GENERATOR_HPP
+#define GITC_MAP_GENERATOR_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// Synthetic but valid referee input for Ghost in the Cell: symmetric
+// factory layout as in the arena (factory 0 in the middle, then mirrored
+// pairs), every factory linked to every other one, distances in [1, 20].
+// Also builds mid-game turns on a generated map to feed Knowledge.
+struct MapGenerator {
+   static constexpr int WIDTH = 16000;
+   static constexpr int HEIGHT = 6500;
+   static constexpr int DISTANCE_MAX = 20;
+
+   explicit MapGenerator(std::uint32_t seed) : m_rng(seed), m_nbFactories(0) {}
+
+   // Init block of a new map. nbFactories is made odd as in the arena.
+   std::string generateInit(int nbFactories) {
+      m_nbFactories = nbFactories | 1;
+      std::vector<int> x(m_nbFactories), y(m_nbFactories);
+      x[0] = WIDTH / 2;
+      y[0] = HEIGHT / 2;
+      std::uniform_int_distribution<int> rx(0, WIDTH / 2), ry(0, HEIGHT);
+      for (int i = 1; i < m_nbFactories; i += 2) {
+         x[i] = rx(m_rng);
+         y[i] = ry(m_rng);
+         x[i + 1] = WIDTH - x[i];
+         y[i + 1] = HEIGHT - y[i];
+      }
+      m_distances.assign(m_nbFactories * m_nbFactories, 0);
+      std::string res;
+      res += std::to_string(m_nbFactories) + '\n';
+      res += std::to_string(m_nbFactories * (m_nbFactories - 1) / 2) + '\n';
+      for (int i = 0; i < m_nbFactories; ++i) {
+         for (int j = i + 1; j < m_nbFactories; ++j) {
+            double euclid = std::hypot(x[i] - x[j], y[i] - y[j]);
+            int d = std::max(1, std::min(DISTANCE_MAX, static_cast<int>(std::lround(euclid / 800))));
+            m_distances[i * m_nbFactories + j] = m_distances[j * m_nbFactories + i] = d;
+            res += std::to_string(i) + ' ' + std::to_string(j) + ' ' + std::to_string(d) + '\n';
+         }
+      }
+      return res;
+   }
+   // First turn of a game: one factory each, everything else neutral.
+   std::string generateStartTurn() {
+      std::uniform_int_distribution<int> cyborgs(0, 10), prod(0, 3), start(15, 30);
+      std::string res = std::to_string(m_nbFactories) + '\n';
+      int nbStart = start(m_rng);
+      int prodStart = 1 + prod(m_rng) % 3;
+      for (int i = 0; i < m_nbFactories; ++i) {
+         int owner = i == 1 ? 1 : (i == 2 ? -1 : 0);
+         bool isStart = owner != 0;
+         res += factory(i, owner, isStart ? nbStart : cyborgs(m_rng), isStart ? prodStart : prod(m_rng), 0);
+      }
+      return res;
+   }
+   // Random mid-game turn: mixed ownership, troops and bombs in flight.
+   std::string generateTurn(int nbTroops) {
+      std::uniform_int_distribution<int> owner(-1, 1), cyborgs(0, 60), prod(0, 3), disabled(0, 5);
+      std::uniform_int_distribution<int> factoryId(0, m_nbFactories - 1), troopSize(1, 25);
+      std::vector<int> owners(m_nbFactories);
+      std::string body;
+      for (int i = 0; i < m_nbFactories; ++i) {
+         owners[i] = i == 1 ? 1 : (i == 2 ? -1 : owner(m_rng));
+         body += factory(i, owners[i], cyborgs(m_rng), prod(m_rng), disabled(m_rng) == 5 ? 3 : 0);
+      }
+      int id = m_nbFactories;
+      for (int t = 0; t < nbTroops; ++t) {
+         int src = factoryId(m_rng);
+         int dst = factoryId(m_rng);
+         if (src == dst || owners[src] == 0)
+            continue;
+         int remaining = 1 + static_cast<int>(m_rng() % m_distances[src * m_nbFactories + dst]);
+         body += std::to_string(id++) + " TROOP " + std::to_string(owners[src]) + ' ' + std::to_string(src) + ' '
+            + std::to_string(dst) + ' ' + std::to_string(troopSize(m_rng)) + ' ' + std::to_string(remaining) + '\n';
+      }
+      if (m_rng() % 4 == 0)
+         body += std::to_string(id++) + " BOMB -1 2 -1 -1 0\n";
+      return std::to_string(id) + '\n' + body;
+   }
+   int getNbFactories() const { return m_nbFactories; }
+   int getDistance(int i, int j) const { return m_distances[i * m_nbFactories + j]; }
+
+private:
+   static std::string factory(int id, int owner, int nbCyborgs, int prodFactor, int disabledTurns) {
+      return std::to_string(id) + " FACTORY " + std::to_string(owner) + ' ' + std::to_string(nbCyborgs) + ' '
+         + std::to_string(prodFactor) + ' ' + std::to_string(disabledTurns) + " 0\n";
+   }
+
+   std::mt19937 m_rng;
+   int m_nbFactories;
+   std::vector<int> m_distances;
+};
+
+#endif
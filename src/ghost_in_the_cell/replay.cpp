@@ -0,0 +1,18 @@
+// Replays a capture log (CG_CAPTURE=file ./ghost_in_the_cell) through
+// Simulation, see replay.hpp; the phase profile of the bot follows.
+//
+// usage: ghost_in_the_cell_replay LOG [--golden FILE] [--update-golden] [--turns]
+#define GITC_NO_MAIN
+#include "main_one_file.cpp"
+
+#include "replay.hpp"
+
+int main(int argc, char** argv) {
+   Replay replay(argc, argv, "ghost_in_the_cell");
+   if (!replay.isValid())
+      return 2;
+   Simulation sim(replay.getInput(), replay.getOutput());
+   const int status = replay.run([&]() { return sim.step(); });
+   sim.getProfiler().print(stdout);
+   return status;
+}
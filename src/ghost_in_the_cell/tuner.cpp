@@ -0,0 +1,188 @@
+// Tournament runner and weight tuner for BestProdStrategy.
+// Matches are played headless (game_engine.hpp) on generated maps, every map
+// twice with the sides swapped, spread over a work-stealing pool with one
+// map seed per game so that results do not depend on the number of threads.
+// The weights are tuned by SPSA: each iteration plays theta + c.delta and
+// theta - c.delta against the opponent on the same maps and moves theta
+// along the difference of their scores. Weights are tuned relative to their
+// defaults (theta = 1 is the arena bot). The default and the best weights
+// are then replayed on fresh maps, with the win rate and its 95% interval.
+//
+// usage: ghost_in_the_cell_tuner [--iterations N] [--matches N] [--final-matches N]
+//                                [--factories N] [--threads T] [--seed S]
+//                                [--opponent greedy|default]
+#define GITC_NO_MAIN
+#include "main_one_file.cpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+#include "game_engine.hpp"
+#include "work_stealing_pool.hpp"
+
+namespace {
+
+struct Options {
+   Options() : nbIterations(50), nbMatches(32), nbFinalMatches(400), nbFactories(NB_FACTORY_MAX), nbThreads(std::thread::hardware_concurrency()),
+      seed(1), opponent("greedy") {}
+   int nbIterations;
+   int nbMatches; // maps per evaluation, each one played twice
+   int nbFinalMatches;
+   int nbFactories;
+   unsigned nbThreads;
+   std::uint32_t seed;
+   std::string opponent;
+};
+
+Options parseOptions(int argc, char** argv) {
+   Options options;
+   for (int i = 1; i + 1 < argc; i += 2) {
+      std::string arg = argv[i];
+      if (arg == "--iterations")
+         options.nbIterations = std::max(0, std::atoi(argv[i + 1]));
+      else if (arg == "--matches")
+         options.nbMatches = std::max(1, std::atoi(argv[i + 1]));
+      else if (arg == "--final-matches")
+         options.nbFinalMatches = std::max(1, std::atoi(argv[i + 1]));
+      else if (arg == "--factories")
+         options.nbFactories = std::max(3, std::min(static_cast<int>(NB_FACTORY_MAX), std::atoi(argv[i + 1])));
+      else if (arg == "--threads")
+         options.nbThreads = static_cast<unsigned>(std::max(1, std::atoi(argv[i + 1])));
+      else if (arg == "--seed")
+         options.seed = static_cast<std::uint32_t>(std::atoi(argv[i + 1]));
+      else if (arg == "--opponent")
+         options.opponent = argv[i + 1];
+   }
+   return options;
+}
+
+struct Score {
+   Score() : nbWins(0), nbDraws(0), nbGames(0) {}
+   // a draw counts half a win
+   double getRate() const { return nbGames == 0 ? 0 : (nbWins + 0.5 * nbDraws) / nbGames; }
+   // normal approximation of the 95% interval
+   double getMargin() const { return nbGames == 0 ? 0 : 1.96 * std::sqrt(getRate() * (1 - getRate()) / nbGames); }
+   int nbWins;
+   int nbDraws;
+   int nbGames;
+};
+
+struct Tournament {
+   Tournament(const Options& options) : m_options(options), m_pool(options.nbThreads), m_nbGames(0) {}
+
+   // Plays every candidate against the opponent on nbMaps maps from seed,
+   // both sides of each map; scores[c] receives the results of candidate c.
+   void play(const std::vector<BestProdParams>& candidates, int nbMaps, std::uint32_t seed, std::vector<Score>& scores) {
+      const std::size_t nbGames = candidates.size() * nbMaps * 2;
+      std::vector<int> outcomes(nbGames); // 1 win, 0 draw, -1 loss for the candidate
+      m_pool.parallelFor(nbGames, [&](unsigned, std::size_t g) {
+         // the bots log every decision, the trace is per thread
+         logging::trace().setOutput(-1);
+         const std::size_t c = g / (2 * nbMaps);
+         const int map = static_cast<int>(g / 2 % nbMaps);
+         const int side = static_cast<int>(g % 2);
+         GameEngine engine(m_options.nbFactories, seed + static_cast<std::uint32_t>(map));
+         BotPlayer bot(candidates[c]);
+         std::unique_ptr<IPlayer> other;
+         if (m_options.opponent == "default")
+            other.reset(new BotPlayer());
+         else
+            other.reset(new GreedyPlayer());
+         const int winner = side == 0 ? playMatch(engine, bot, *other) : playMatch(engine, *other, bot);
+         outcomes[g] = winner == -1 ? 0 : (winner == side ? 1 : -1);
+      });
+      m_nbGames += static_cast<long long>(nbGames);
+      scores.assign(candidates.size(), Score());
+      for (std::size_t g = 0; g < nbGames; ++g) {
+         Score& s = scores[g / (2 * nbMaps)];
+         s.nbWins += outcomes[g] == 1;
+         s.nbDraws += outcomes[g] == 0;
+         ++s.nbGames;
+      }
+   }
+
+   const Options& m_options;
+   WorkStealingPool m_pool;
+   long long m_nbGames;
+};
+
+const double THETA_MIN = 0.1;
+const double THETA_MAX = 5;
+
+BestProdParams toParams(const std::vector<double>& theta) {
+   BestProdParams params;
+   for (int i = 0; i < BestProdParams::NB_PARAMS; ++i)
+      params[i] *= theta[i];
+   return params;
+}
+
+void printParams(const char* title, const BestProdParams& params) {
+   std::printf("%s", title);
+   for (int i = 0; i < BestProdParams::NB_PARAMS; ++i)
+      std::printf(" %s=%.3f", BestProdParams::getName(i), params[i]);
+   std::printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+   const Options options = parseOptions(argc, argv);
+   Tournament tournament(options);
+   std::mt19937 rng(options.seed);
+   std::bernoulli_distribution coin(0.5);
+
+   // SPSA gains (Spall): a_k = a / (k + 1 + A)^0.602, c_k = c / (k + 1)^0.101
+   const double a = 0.2;
+   const double c = 0.1;
+   const double A = 0.1 * options.nbIterations;
+   std::vector<double> theta(BestProdParams::NB_PARAMS, 1.0);
+   std::uint32_t mapSeed = options.seed * 7919u;
+
+   auto start = std::chrono::steady_clock::now();
+   std::printf("%5s %9s %9s  theta\n", "iter", "plus", "minus");
+   for (int k = 0; k < options.nbIterations; ++k) {
+      const double ak = a / std::pow(k + 1 + A, 0.602);
+      const double ck = c / std::pow(k + 1, 0.101);
+      std::vector<double> delta(BestProdParams::NB_PARAMS);
+      std::vector<BestProdParams> candidates(2);
+      std::vector<double> plus(theta), minus(theta);
+      for (int i = 0; i < BestProdParams::NB_PARAMS; ++i) {
+         delta[i] = coin(rng) ? 1 : -1;
+         plus[i] = std::max(THETA_MIN, std::min(THETA_MAX, theta[i] + ck * delta[i]));
+         minus[i] = std::max(THETA_MIN, std::min(THETA_MAX, theta[i] - ck * delta[i]));
+      }
+      candidates[0] = toParams(plus);
+      candidates[1] = toParams(minus);
+      std::vector<Score> scores;
+      tournament.play(candidates, options.nbMatches, mapSeed, scores);
+      mapSeed += static_cast<std::uint32_t>(options.nbMatches);
+      // gradient ascent on the win rate
+      const double diff = scores[0].getRate() - scores[1].getRate();
+      for (int i = 0; i < BestProdParams::NB_PARAMS; ++i)
+         theta[i] = std::max(THETA_MIN, std::min(THETA_MAX, theta[i] + ak * diff / (2 * ck * delta[i])));
+      std::printf("%5d %8.1f%% %8.1f%% ", k, 100 * scores[0].getRate(), 100 * scores[1].getRate());
+      for (double t : theta)
+         std::printf(" %.3f", t);
+      std::printf("\n");
+      std::fflush(stdout);
+   }
+
+   // final comparison on maps the tuning never saw
+   std::vector<BestProdParams> finalists(2);
+   finalists[1] = toParams(theta);
+   std::vector<Score> scores;
+   tournament.play(finalists, options.nbFinalMatches, mapSeed, scores);
+   const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+   std::printf("opponent %s  factories %d  threads %u\n", options.opponent.c_str(), options.nbFactories, tournament.m_pool.size());
+   const char* const NAMES[2] = { "default", "tuned" };
+   for (int i = 0; i < 2; ++i)
+      std::printf("%-8s win rate %.1f%% +- %.1f%% over %d games\n", NAMES[i], 100 * scores[i].getRate(), 100 * scores[i].getMargin(),
+         scores[i].nbGames);
+   printParams("tuned   ", finalists[1]);
+   std::printf("%lld games  %.1f games/s\n", tournament.m_nbGames, tournament.m_nbGames / seconds);
+   return 0;
+}
@@ -0,0 +1,62 @@
+#!/bin/bash
+# Profile guided build of the bots, trained on capture logs (CG_CAPTURE=FILE),
+# then the time per phase of the reference and PGO builds on the same logs.
+#
+# usage: tools/pgo.sh CORPUS_DIR [BUILD_DIR] [REPEAT]
+# CORPUS_DIR holds the *.cap logs of either bot. Both builds are Release
+# with LTO: the reference one goes to BUILD_DIR/ref, the PGO one (the
+# binaries to ship) to BUILD_DIR/pgo. The report sums every phase over
+# REPEAT (default 5) plays of the corpus.
+set -euo pipefail
+
+src=$(cd "$(dirname "$0")/.." && pwd)
+corpus=$(cd "$1" && pwd)
+build=${2:-$src/_pgo_build}
+repeat=${3:-5}
+bots="code_buster ghost_in_the_cell"
+
+binary() {
+   case $2 in
+   code_buster) echo "$1/src/codebuster/code_buster" ;;
+   *) echo "$1/src/ghost_in_the_cell/$2" ;;
+   esac
+}
+# bot name and raw input of a capture log, see include/capture.hpp
+capture_bot() { dd if="$1" bs=1 skip=16 count=32 2>/dev/null | tr -d '\0'; }
+capture_input() { tail -c +$(($(od -An -tu4 -j12 -N4 "$1") + 1)) "$1"; }
+configure() {
+   cmake -S "$src" -B "$1" -DCMAKE_BUILD_TYPE=Release -DCG_LTO=ON "${@:2}" >/dev/null
+   cmake --build "$1" -j"$(nproc)" --target $bots >/dev/null
+}
+# Plays the corpus with the bots of build dir $1, their profiles go to $2.
+play() {
+   for log in "$corpus"/*.cap; do
+      bot=$(capture_bot "$log")
+      capture_input "$log" | "$(binary "$1" "$bot")" 2>&1 >/dev/null | sed "s/^/$bot /" >>"$2"
+   done
+}
+# Sums the time per bot and phase of the profiles printed at EOF.
+totals() {
+   awk '$2 ~ /^(parse|decide|emit|turn)$/ && NF == 9 { t[$1 " " $2] += $3 * $4 }
+        END { for (k in t) print k, t[k] }' "$1" | sort
+}
+
+ls "$corpus"/*.cap >/dev/null
+echo "reference build in $build/ref"
+configure "$build/ref" -DCG_PGO=OFF
+echo "instrumented build in $build/pgo"
+rm -rf "$build/pgo/pgo"
+configure "$build/pgo" -DCG_PGO=GENERATE -DCG_PGO_DIR="$build/pgo/pgo"
+play "$build/pgo" /dev/null
+echo "optimised build from the profiles of $(ls "$corpus"/*.cap | wc -l) logs"
+configure "$build/pgo" -DCG_PGO=USE -DCG_PGO_DIR="$build/pgo/pgo"
+
+: >"$build/ref.prof"
+: >"$build/pgo.prof"
+for ((r = 0; r < repeat; ++r)); do
+   play "$build/ref" "$build/ref.prof"
+   play "$build/pgo" "$build/pgo.prof"
+done
+printf "%-18s %-7s %12s %12s %8s\n" bot phase "ref(us)" "pgo(us)" speedup
+join <(totals "$build/ref.prof" | awk '{ print $1 "/" $2, $3 }') <(totals "$build/pgo.prof" | awk '{ print $1 "/" $2, $3 }') |
+   awk '{ split($1, k, "/"); printf "%-18s %-7s %12.1f %12.1f %7.2fx\n", k[1], k[2], $2, $3, ($3 > 0 ? $2 / $3 : 0) }'